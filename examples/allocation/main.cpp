@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//number of messages per run
+static const size_t MESSAGES = 500000;
+
+
+//returns the current time in seconds
+static double now() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+//an actor which holds a value
+class value : public actor {
+public:
+    value(memory_resource *mr) : actor(mr) {}
+
+    ~value() {
+        stop();
+    }
+
+    void set(const string &v) {
+        put(&value::_set, v);
+    }
+
+    result<size_t> size() {
+        return put(&value::_size);
+    }
+
+private:
+    string m_value;
+
+    void _set(const string &v) {
+        m_value = v;
+    }
+
+    size_t _size() {
+        return m_value.size();
+    }
+};
+
+
+//runs the benchmark with the given resource
+static void bench(const char *name, memory_resource *mr) {
+    value v(mr);
+    string s(40, 'x');
+
+    //one-way messages
+    double t0 = now();
+    for (size_t i = 0; i < MESSAGES; ++i) {
+        v.set(s);
+    }
+    v.size().get();
+    double t1 = now();
+
+    //request/reply, with a window of results in flight
+    vector<result<size_t> > results;
+    results.reserve(64);
+    for (size_t i = 0; i < MESSAGES; ++i) {
+        results.push_back(v.size());
+        if (results.size() == 64) {
+            for (size_t j = 0; j < results.size(); ++j) results[j].get();
+            results.clear();
+        }
+    }
+    for (size_t j = 0; j < results.size(); ++j) results[j].get();
+    double t2 = now();
+
+    printf("%-12s: one-way %10.0f messages/s, request/reply %10.0f requests/s\n",
+        name, MESSAGES / (t1 - t0), MESSAGES / (t2 - t1));
+}
+
+
+int main() {
+    bench("global heap", 0);
+
+    pool_resource pool;
+    bench("pool", &pool);
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <cstdio>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//number of requests
+static const int REQUESTS = 100000;
+
+
+//number of workers
+static const int WORKERS = 4;
+
+
+//a worker which squares numbers
+class worker : public actor {
+public:
+    ~worker() {
+        stop();
+    }
+
+    result<long> square(long v) {
+        return put(&worker::_square, v);
+    }
+
+private:
+    long _square(const long &v) {
+        return v * v;
+    }
+};
+
+
+//sums the squares, waiting for each result in its own thread
+class blocking_aggregator : public actor {
+public:
+    blocking_aggregator(worker *workers) : m_workers(workers) {}
+
+    ~blocking_aggregator() {
+        stop();
+    }
+
+    result<long> sum(int n) {
+        return put(&blocking_aggregator::_sum, n);
+    }
+
+private:
+    worker *m_workers;
+
+    long _sum(const int &n) {
+        long sum = 0;
+        for (int i = 0; i < n; ++i) {
+            sum += m_workers[i % WORKERS].square(i).get();
+        }
+        return sum;
+    }
+};
+
+
+//sums the squares, receiving each result as a message
+class asking_aggregator : public actor {
+public:
+    asking_aggregator(worker *workers) : m_workers(workers), m_sum(0), m_pending(0) {}
+
+    ~asking_aggregator() {
+        stop();
+    }
+
+    result<long> sum(int n) {
+        result<long> r;
+        put(&asking_aggregator::_sum, n, r);
+        return r;
+    }
+
+private:
+    worker *m_workers;
+    long m_sum;
+    int m_pending;
+    result<long> m_result;
+
+    void _sum(const int &n, const result<long> &r) {
+        m_sum = 0;
+        m_pending = n;
+        m_result = r;
+        for (int i = 0; i < n; ++i) {
+            ask(m_workers[i % WORKERS].square(i), &asking_aggregator::_square);
+        }
+    }
+
+    void _square(const long &v) {
+        m_sum += v;
+        if (--m_pending == 0) m_result.set(m_sum);
+    }
+};
+
+
+//runs an aggregator
+template <class A> static void run(const char *name, worker *workers) {
+    A a(workers);
+    unsigned long long start = now_ns();
+    long sum = a.sum(REQUESTS).get();
+    printf("%-8s sum %ld in %.3f s\n", name, sum, (now_ns() - start) / 1e9);
+}
+
+
+int main() {
+    worker workers[WORKERS];
+    run<blocking_aggregator>("blocking", workers);
+    run<asking_aggregator>("ask", workers);
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <cstdio>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//The example implements a connection as a state machine twice: with an enum
+//which every handler branches on, and with behaviors, which the actor switches
+//with become(). It shows the transitions, and measures the messages
+//per second of both, and of plain messages without a state machine.
+
+
+//number of messages for the benchmark
+static const size_t MESSAGES = 2000000;
+
+
+//returns the throughput for the given time
+static double rate(unsigned long long start) {
+    return MESSAGES / ((now_ns() - start) / 1e9);
+}
+
+
+class connection;
+
+
+//the behavior table of the connection: one handler per event
+struct connection_behavior {
+    void (connection::*connect)();
+    void (connection::*disconnect)();
+    int (connection::*send)(const int &);
+};
+
+
+//a connection; data can be sent only while connected
+class connection : public actor {
+public:
+    connection() : m_sent(0) {
+        become(disconnected);
+    }
+
+    ~connection() {
+        stop();
+    }
+
+    void connect() {
+        put_event(&connection_behavior::connect);
+    }
+
+    void disconnect() {
+        put_event(&connection_behavior::disconnect);
+    }
+
+    result<int> send(int v) {
+        return put_event(&connection_behavior::send, v);
+    }
+
+private:
+    //the behaviors
+    static const connection_behavior disconnected;
+    static const connection_behavior connected;
+
+    //number of values sent
+    int m_sent;
+
+    void _connect() {
+        become(connected);
+    }
+
+    void _disconnect() {
+        become(disconnected);
+    }
+
+    int _send(const int &v) {
+        return m_sent += v;
+    }
+};
+
+
+//while disconnected, sending is not handled
+const connection_behavior connection::disconnected = { &connection::_connect, 0, 0 };
+const connection_behavior connection::connected = { 0, &connection::_disconnect, &connection::_send };
+
+
+//the same connection, with an enum
+class enum_connection : public actor {
+public:
+    enum_connection() : m_state(DISCONNECTED), m_sent(0) {}
+
+    ~enum_connection() {
+        stop();
+    }
+
+    void connect() {
+        put(&enum_connection::_connect);
+    }
+
+    result<int> send(int v) {
+        return put(&enum_connection::_send, v);
+    }
+
+private:
+    enum state { DISCONNECTED, CONNECTED } m_state;
+    int m_sent;
+
+    void _connect() {
+        switch (m_state) {
+            case DISCONNECTED: m_state = CONNECTED; break;
+            case CONNECTED: break;
+        }
+    }
+
+    int _send(const int &v) {
+        switch (m_state) {
+            case DISCONNECTED: return -1;
+            case CONNECTED: return m_sent += v;
+        }
+        return -1;
+    }
+};
+
+
+//plain messages
+class plain : public actor {
+public:
+    plain() : m_sent(0) {}
+
+    ~plain() {
+        stop();
+    }
+
+    result<int> send(int v) {
+        return put(&plain::_send, v);
+    }
+
+private:
+    int m_sent;
+
+    int _send(const int &v) {
+        return m_sent += v;
+    }
+};
+
+
+int main() {
+    {
+        connection c;
+        try {
+            c.send(1).get();
+        }
+        catch (const actor_error &e) {
+            printf("send while disconnected: %s\n", e.what());
+        }
+        c.connect();
+        printf("send while connected: %d\n", c.send(1).get());
+        c.disconnect();
+        c.connect();
+        printf("send after reconnecting: %d\n", c.send(1).get());
+    }
+
+    result<int> r;
+    {
+        plain p;
+        unsigned long long start = now_ns();
+        for (size_t i = 0; i < MESSAGES; ++i) r = p.send(1);
+        r.get();
+        printf("plain messages: %10.0f per second\n", rate(start));
+    }
+    {
+        enum_connection c;
+        c.connect();
+        unsigned long long start = now_ns();
+        for (size_t i = 0; i < MESSAGES; ++i) r = c.send(1);
+        r.get();
+        printf("enum switch:    %10.0f per second\n", rate(start));
+    }
+    {
+        connection c;
+        c.connect();
+        unsigned long long start = now_ns();
+        for (size_t i = 0; i < MESSAGES; ++i) r = c.send(1);
+        r.get();
+        printf("behaviors:      %10.0f per second\n", rate(start));
+    }
+    return 0;
+}
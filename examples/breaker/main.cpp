@@ -0,0 +1,154 @@
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include "breaker.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//The benchmark runs clients against a backend actor which degrades
+//for a while: its requests become slow, and then fail. Without a breaker,
+//the clients keep putting requests, which pile up in the backend's queue;
+//with a breaker, they fail fast while the backend is degraded,
+//and the breaker probes it until it recovers. It reports the requests
+//which succeeded and failed, the requests the backend executed in total
+//and while degraded, and the longest time a client waited.
+
+
+//number of clients
+static const size_t CLIENTS = 4;
+
+
+//the backend is degraded from the 1st to the 2nd second; the run lasts 3 seconds
+static const unsigned long long DEGRADED_START = 1000000000ULL;
+static const unsigned long long DEGRADED_END = 2000000000ULL;
+static const unsigned long long RUN = 3000000000ULL;
+
+
+//the backend
+class backend : public actor {
+public:
+    backend() : m_start(now_ns()), m_executed(0), m_degraded(0) {}
+
+    ~backend() {
+        stop();
+    }
+
+    result<int> query(int v) {
+        return put(&backend::_query, v);
+    }
+
+    result<size_t> executed() {
+        return put(&backend::_executed);
+    }
+
+    result<size_t> degraded() {
+        return put(&backend::_degraded);
+    }
+
+    unsigned long long start() const {
+        return m_start;
+    }
+
+private:
+    unsigned long long m_start;
+    size_t m_executed;
+    size_t m_degraded;
+
+    int _query(const int &v) {
+        ++m_executed;
+        unsigned long long t = now_ns() - m_start;
+        if (t >= DEGRADED_START && t < DEGRADED_END) {
+            ++m_degraded;
+            usleep(20000);
+            throw runtime_error("backend degraded");
+        }
+        usleep(200);
+        return v;
+    }
+
+    size_t _executed() {
+        return m_executed;
+    }
+
+    size_t _degraded() {
+        return m_degraded;
+    }
+};
+
+
+//a client's counters
+struct client_stats {
+    size_t ok;
+    size_t failed;
+    unsigned long long max_wait;
+};
+
+
+//the arguments of a client thread
+struct client_args {
+    backend *target;
+    circuit_breaker *breaker;
+    client_stats stats;
+};
+
+
+//puts requests until the end of the run
+static void *client(void *arg) {
+    client_args &a = *static_cast<client_args *>(arg);
+    a.stats.ok = a.stats.failed = 0;
+    a.stats.max_wait = 0;
+    for (int i = 0; now_ns() - a.target->start() < RUN; ++i) {
+        unsigned long long t = now_ns();
+        try {
+            if (a.breaker) a.breaker->call(a.target, &backend::query, i);
+            else a.target->query(i).get();
+            ++a.stats.ok;
+        }
+        catch (const actor_error &) {
+            ++a.stats.failed;
+            usleep(1000);
+        }
+        a.stats.max_wait = max(a.stats.max_wait, now_ns() - t);
+    }
+    return 0;
+}
+
+
+//runs the clients, with or without a breaker
+static void run(const char *name, circuit_breaker *breaker) {
+    backend b;
+    vector<client_args> args(CLIENTS);
+    vector<pthread_t> threads(CLIENTS);
+    for (size_t i = 0; i < CLIENTS; ++i) {
+        args[i].target = &b;
+        args[i].breaker = breaker;
+        pthread_create(&threads[i], NULL, client, &args[i]);
+    }
+    size_t ok = 0, failed = 0;
+    unsigned long long max_wait = 0;
+    for (size_t i = 0; i < CLIENTS; ++i) {
+        pthread_join(threads[i], NULL);
+        ok += args[i].stats.ok;
+        failed += args[i].stats.failed;
+        max_wait = max(max_wait, args[i].stats.max_wait);
+    }
+    printf("%-10s %8lu %8lu %10lu %12lu %12.1f", name, (unsigned long)ok, (unsigned long)failed,
+        (unsigned long)b.executed().get(), (unsigned long)b.degraded().get(), max_wait / 1e6);
+    if (breaker) {
+        circuit_breaker::stats s = breaker->statistics();
+        printf("   opened %ld times, %ld rejected, %ld timeouts, %ld failures", s.opened, s.rejected, s.timeouts, s.failures);
+    }
+    printf("\n");
+}
+
+
+int main() {
+    printf("%-10s %8s %8s %10s %12s %12s\n", "breaker", "ok", "failed", "executed", "degraded", "max wait ms");
+    run("none", 0);
+    circuit_breaker breaker(3, 50, 200);
+    run("breaker", &breaker);
+    return 0;
+}
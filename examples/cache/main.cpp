@@ -0,0 +1,140 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <sys/time.h>
+#include "cache.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//number of keys
+static const size_t KEYS = 100000;
+
+//number of client threads
+static const size_t CLIENTS = 8;
+
+//number of requests per client
+static const size_t REQUESTS = 20000;
+
+
+//returns the current time in microseconds
+static double now_us() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+
+//zipfian key generator, as in YCSB
+class zipfian {
+public:
+    zipfian(size_t n, double theta) : m_n(n), m_theta(theta) {
+        m_zetan = zeta(n, theta);
+        double zeta2 = zeta(2, theta);
+        m_alpha = 1.0 / (1.0 - theta);
+        m_eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / m_zetan);
+    }
+
+    size_t next(unsigned &seed) const {
+        double u = (double)rand_r(&seed) / RAND_MAX;
+        double uz = u * m_zetan;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + pow(0.5, m_theta)) return 1;
+        size_t k = (size_t)(m_n * pow(m_eta * u - m_eta + 1.0, m_alpha));
+        return k < m_n ? k : m_n - 1;
+    }
+
+private:
+    size_t m_n;
+    double m_theta;
+    double m_zetan;
+    double m_alpha;
+    double m_eta;
+
+    static double zeta(size_t n, double theta) {
+        double sum = 0;
+        for (size_t i = 1; i <= n; ++i) sum += 1.0 / pow((double)i, theta);
+        return sum;
+    }
+};
+
+
+//an expensive backend computation
+struct backend {
+    double operator ()(const unsigned &k) const {
+        double v = k;
+        for (int i = 0; i < 1000; ++i) v = sin(v) + k;
+        return v;
+    }
+};
+
+
+//the cache type
+typedef cache<unsigned, double, backend> cache_type;
+
+
+//a client thread
+struct client {
+    cache_type *m_cache;
+    const zipfian *m_keys;
+    unsigned m_seed;
+    vector<double> m_latencies;
+
+    static void *run(void *arg) {
+        client *c = (client *)arg;
+        c->m_latencies.reserve(REQUESTS);
+        for (size_t i = 0; i < REQUESTS; ++i) {
+            unsigned k = (unsigned)c->m_keys->next(c->m_seed);
+            double t0 = now_us();
+            c->m_cache->get(k).get();
+            c->m_latencies.push_back(now_us() - t0);
+        }
+        return 0;
+    }
+};
+
+
+//runs the benchmark with the given skew and budget
+static void bench(worker_group &workers, double theta, size_t budget) {
+    zipfian keys(KEYS, theta);
+    cache_type c(workers, backend(), budget);
+
+    vector<client> clients(CLIENTS);
+    vector<pthread_t> threads(CLIENTS);
+    double t0 = now_us();
+    for (size_t i = 0; i < CLIENTS; ++i) {
+        clients[i].m_cache = &c;
+        clients[i].m_keys = &keys;
+        clients[i].m_seed = (unsigned)i + 1;
+        pthread_create(&threads[i], NULL, client::run, &clients[i]);
+    }
+    vector<double> latencies;
+    for (size_t i = 0; i < CLIENTS; ++i) {
+        pthread_join(threads[i], NULL);
+        latencies.insert(latencies.end(), clients[i].m_latencies.begin(), clients[i].m_latencies.end());
+    }
+    double elapsed = now_us() - t0;
+
+    sort(latencies.begin(), latencies.end());
+    cache_stats s = c.stats();
+    double requests = (double)latencies.size();
+    printf("theta %.2f, budget %6u: hit rate %5.1f%%, coalesced %6lu, loads %6lu, evictions %6lu, "
+        "p50 %7.1f us, p99 %8.1f us, %8.0f req/s\n",
+        theta, (unsigned)budget, 100.0 * s.hits / requests, s.coalesced, s.loads, s.evictions,
+        latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], requests * 1000000.0 / elapsed);
+}
+
+
+int main() {
+    worker_group workers;
+    double thetas[] = {0.99, 0.8, 0.5};
+    size_t budgets[] = {1000, 10000};
+    for (size_t t = 0; t < sizeof(thetas) / sizeof(thetas[0]); ++t) {
+        for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); ++b) {
+            bench(workers, thetas[t], budgets[b]);
+        }
+    }
+    return 0;
+}
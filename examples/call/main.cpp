@@ -0,0 +1,83 @@
+#include <cstdio>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//number of round trips
+static const int CALLS = 200000;
+
+
+//a resource which counts the allocations of messages and results
+class counting_resource : public memory_resource {
+public:
+    volatile long m_allocations;
+
+    counting_resource() : m_allocations(0) {}
+
+protected:
+    virtual void *do_allocate(size_t bytes) {
+        atomic_increment(&m_allocations);
+        return new_delete_resource()->allocate(bytes);
+    }
+
+    virtual void do_deallocate(void *p, size_t bytes) {
+        new_delete_resource()->deallocate(p, bytes);
+    }
+};
+
+
+//the resource of the actor
+static counting_resource resource;
+
+
+//an actor with a counter
+class counter : public actor {
+public:
+    counter() : actor(&resource), m_value(0) {}
+
+    ~counter() {
+        stop();
+    }
+
+    //increments the counter, with a put whose result is waited for
+    int put_increment(int n) {
+        return put(&counter::_increment, n).get();
+    }
+
+    //increments the counter, with a call
+    int call_increment(int n) {
+        return call(&counter::_increment, n);
+    }
+
+private:
+    int m_value;
+
+    int _increment(const int &n) {
+        m_value += n;
+        return m_value;
+    }
+};
+
+
+//runs the round trips with the given function, and prints the time and allocations
+static void run(const char *name, counter &c, int (counter::*f)(int)) {
+    long allocations = atomic_load(&resource.m_allocations);
+    unsigned long long start = now_ns();
+    int v = 0;
+    for (int i = 0; i < CALLS; ++i) {
+        v = (c.*f)(1);
+    }
+    unsigned long long ns = now_ns() - start;
+    long n = atomic_load(&resource.m_allocations) - allocations;
+    printf("%-5s value %d: %.0f ns per round trip, %.2f allocations per round trip\n", name, v, (double)ns / CALLS, (double)n / CALLS);
+}
+
+
+int main() {
+    counter c;
+    c.call_increment(0);
+    run("put", c, &counter::put_increment);
+    run("call", c, &counter::call_increment);
+    return 0;
+}
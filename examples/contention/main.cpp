@@ -0,0 +1,115 @@
+#include <cstdio>
+#include <vector>
+#include <sys/time.h>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//The benchmark measures the throughput of an actor which receives
+//messages from many threads, while its handler updates its own state.
+//Build it a second time, with actorlib.cpp, with -DACTORLIB_CACHE_LINE_SIZE=1
+//for the packed layout, without padding, to compare.
+
+
+//number of messages per producer
+static const size_t MESSAGES = 200000;
+
+
+//returns the current time in seconds
+static double now() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+//a counter actor; its state follows the actor's members
+class counter : public actor {
+public:
+    counter() : m_count(0), m_sum(0) {}
+
+    ~counter() {
+        stop();
+    }
+
+    void add(int v) {
+        put(&counter::_add, v);
+    }
+
+    result<size_t> count() {
+        return put(&counter::_count);
+    }
+
+private:
+    size_t m_count;
+    long m_sum;
+
+    void _add(const int &v) {
+        ++m_count;
+        m_sum += v;
+    }
+
+    size_t _count() {
+        return m_count;
+    }
+};
+
+
+//a producer thread
+static void *produce(void *arg) {
+    counter *c = (counter *)arg;
+    for (size_t i = 0; i < MESSAGES; ++i) {
+        c->add((int)i);
+    }
+    return 0;
+}
+
+
+//a thread which copies a result many times, so as that the threads
+//copying the same result update its reference count concurrently
+static void *copy_result(void *arg) {
+    result<int> *r = (result<int> *)arg;
+    for (size_t i = 0; i < MESSAGES; ++i) {
+        result<int> copy(*r);
+    }
+    return 0;
+}
+
+
+int main() {
+    printf("cache line padding %d, sizeof(actor) %u\n", ACTORLIB_CACHE_LINE_SIZE, (unsigned)sizeof(actor));
+
+    //fan-in to one actor
+    for (size_t producers = 1; producers <= 8; producers *= 2) {
+        counter c;
+        vector<pthread_t> threads(producers);
+        double t0 = now();
+        for (size_t i = 0; i < producers; ++i) {
+            pthread_create(&threads[i], NULL, produce, &c);
+        }
+        for (size_t i = 0; i < producers; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+        size_t n = c.count();
+        double t1 = now();
+        printf("%u producer(s): %10.0f messages/s\n", (unsigned)producers, n / (t1 - t0));
+    }
+
+    //copies of a shared result
+    for (size_t copiers = 1; copiers <= 8; copiers *= 2) {
+        result<int> r;
+        vector<pthread_t> threads(copiers);
+        double t0 = now();
+        for (size_t i = 0; i < copiers; ++i) {
+            pthread_create(&threads[i], NULL, copy_result, &r);
+        }
+        for (size_t i = 0; i < copiers; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+        double t1 = now();
+        printf("%u result copier(s): %10.0f copies/s\n", (unsigned)copiers, copiers * MESSAGES / (t1 - t0));
+    }
+
+    return 0;
+}
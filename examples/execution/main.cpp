@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <string>
+#include "execution.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+#if ACTORLIB_HAS_MOVE
+
+
+//an account actor
+class account : public actor {
+public:
+    account(int balance) : m_balance(balance) {}
+
+    ~account() {
+        stop();
+    }
+
+    //deposits an amount, and returns the new balance
+    result<int> deposit(int amount) {
+        return put(&account::_deposit, amount);
+    }
+
+private:
+    int m_balance;
+
+    int _deposit(const int &amount) {
+        if (amount < 0) throw runtime_error("negative deposit");
+        m_balance += amount;
+        return m_balance;
+    }
+};
+
+
+//a receiver which prints how it was completed, and signals the main thread;
+//with std::execution, the senders compose with its algorithms instead
+class print_receiver {
+public:
+    print_receiver(const char *name, result<bool> done) : m_name(name), m_done(done) {}
+
+    void set_value() noexcept {
+        printf("%s: completed in the actor thread %s\n", m_name, pthread_equal(pthread_self(), main_thread) ? "no" : "yes");
+        m_done.set(true);
+    }
+
+    void set_value(int v) noexcept {
+        printf("%s: value %d\n", m_name, v);
+        m_done.set(true);
+    }
+
+    void set_error(exception_ptr e) noexcept {
+        try {
+            rethrow_exception(e);
+        }
+        catch (const exception &ex) {
+            printf("%s: error %s\n", m_name, ex.what());
+        }
+        m_done.set(false);
+    }
+
+    static pthread_t main_thread;
+
+private:
+    const char *m_name;
+    result<bool> m_done;
+};
+
+
+pthread_t print_receiver::main_thread;
+
+
+int main() {
+    print_receiver::main_thread = pthread_self();
+    account acc(100);
+
+    //work scheduled on the actor
+    result<bool> scheduled;
+    auto op1 = schedule(acc).connect(print_receiver("schedule", scheduled));
+    op1.start();
+    scheduled.get();
+
+    //results adapted to senders, which complete without a blocked thread
+    result<bool> deposited;
+    auto op2 = as_sender(acc.deposit(50)).connect(print_receiver("deposit", deposited));
+    op2.start();
+    deposited.get();
+
+    result<bool> failed;
+    auto op3 = as_sender(acc.deposit(-1)).connect(print_receiver("bad deposit", failed));
+    op3.start();
+    failed.get();
+    return 0;
+}
+
+
+#else
+
+
+int main() {
+    printf("the senders need C++11\n");
+    return 0;
+}
+
+
+#endif
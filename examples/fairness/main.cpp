@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//A client pings a server while another client floods it with requests.
+//With one queue, each ping waits behind all the queued requests;
+//with fair queuing, it waits for one turn of the flooding client.
+
+
+//number of requests of the flooding client
+static const int REQUESTS = 100000;
+
+
+//number of pings of the other client
+static const int PINGS = 50;
+
+
+//a server actor
+class server : public actor {
+public:
+    server(bool fair) : m_requests(0) {
+        if (fair) enable_fair_queuing(4);
+    }
+
+    ~server() {
+        stop();
+    }
+
+    //a request which takes some work
+    void request() {
+        put(&server::_request);
+    }
+
+    //returns the time from the given time to the execution of the ping
+    result<unsigned long long> ping(unsigned long long t) {
+        return put(&server::_ping, t);
+    }
+
+private:
+    int m_requests;
+
+    void _request() {
+        volatile int x = 0;
+        for (int i = 0; i < 1000; ++i) x += i;
+        ++m_requests;
+    }
+
+    unsigned long long _ping(const unsigned long long &t) {
+        return now_ns() - t;
+    }
+};
+
+
+//the flooding client
+static void *flood(void *arg) {
+    server *s = (server *)arg;
+    for (int i = 0; i < REQUESTS; ++i) {
+        s->request();
+    }
+    return 0;
+}
+
+
+int main() {
+    for (int fair = 0; fair <= 1; ++fair) {
+        server s(fair != 0);
+        pthread_t thread;
+        pthread_create(&thread, NULL, flood, &s);
+        usleep(10000);
+
+        //the latencies of the pings
+        vector<unsigned long long> latencies;
+        for (int i = 0; i < PINGS; ++i) {
+            latencies.push_back(s.ping(now_ns()).get());
+            usleep(1000);
+        }
+        pthread_join(thread, NULL);
+
+        sort(latencies.begin(), latencies.end());
+        printf("%-14s ping median %8.3f ms, max %8.3f ms\n",
+            fair ? "fair queuing:" : "one queue:",
+            latencies[PINGS / 2] / 1000000.0, latencies.back() / 1000000.0);
+    }
+    return 0;
+}
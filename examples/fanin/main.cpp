@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <vector>
+#include <sys/time.h>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//The benchmark measures the throughput of one hot actor which receives
+//messages from 1 to 128 threads, with the default mailbox, where every
+//put takes the mutex of the actor, and with publication slots, where
+//the threads put their messages in slots of their own.
+
+
+//total number of messages, shared by the producers
+static const size_t MESSAGES = 1 << 20;
+
+
+//returns the current time in seconds
+static double now() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+//a counter actor
+class counter : public actor {
+public:
+    counter(bool slots) : m_count(0) {
+        if (slots) enable_publication_slots();
+    }
+
+    ~counter() {
+        stop();
+    }
+
+    void add(int v) {
+        put(&counter::_add, v);
+    }
+
+    result<size_t> count() {
+        return put(&counter::_count);
+    }
+
+private:
+    size_t m_count;
+
+    void _add(const int &v) {
+        ++m_count;
+    }
+
+    size_t _count() {
+        return m_count;
+    }
+};
+
+
+//a producer
+struct producer {
+    counter *c;
+    size_t messages;
+};
+
+
+//a producer thread
+static void *produce(void *arg) {
+    producer *p = (producer *)arg;
+    for (size_t i = 0; i < p->messages; ++i) {
+        p->c->add((int)i);
+    }
+    return 0;
+}
+
+
+//returns the throughput of the given number of producers, in messages per second
+static double measure(bool slots, size_t producers) {
+    counter c(slots);
+    vector<pthread_t> threads(producers);
+    producer p = { &c, MESSAGES / producers };
+    double t0 = now();
+    for (size_t i = 0; i < producers; ++i) {
+        pthread_create(&threads[i], NULL, produce, &p);
+    }
+    for (size_t i = 0; i < producers; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    //messages of different threads may be reordered in the slots,
+    //so the count is polled until all of them are executed
+    size_t total = p.messages * producers, n;
+    while ((n = c.count()) < total) {}
+    double t1 = now();
+    return n / (t1 - t0);
+}
+
+
+int main() {
+    printf("%10s %18s %18s\n", "producers", "mutex messages/s", "slots messages/s");
+    for (size_t producers = 1; producers <= 128; producers *= 2) {
+        double mutex = measure(false, producers);
+        double slots = measure(true, producers);
+        printf("%10u %18.0f %18.0f\n", (unsigned)producers, mutex, slots);
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <vector>
+#include <pthread.h>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//The benchmark destroys and recreates actors continuously, while
+//producer threads put messages to them through handles, without locks.
+//A handle to a destroyed actor no longer resolves, even if its slot
+//has been recycled for a new actor, so the put fails instead of
+//touching freed memory.
+
+
+//number of actors alive at any time
+static const size_t ACTORS = 64;
+
+
+//number of actors destroyed and recreated
+static const size_t CHURN = 20000;
+
+
+//number of producer threads
+static const size_t PRODUCERS = 4;
+
+
+//a counter actor
+class counter : public actor {
+public:
+    counter() : m_count(0) {}
+
+    ~counter() {
+        stop();
+    }
+
+    void add() {
+        put(&counter::_add);
+    }
+
+private:
+    size_t m_count;
+
+    void _add() {
+        ++m_count;
+    }
+};
+
+
+//the handles of each producer, taken before the churn
+static vector<handle<counter> > handles[PRODUCERS];
+
+
+//the actors
+static counter *actors[ACTORS];
+
+
+//set when the churn is over
+static volatile long done = 0;
+
+
+//puts messages until the churn is over
+static void *produce(void *arg) {
+    vector<handle<counter> > &h = *static_cast<vector<handle<counter> > *>(arg);
+    size_t delivered = 0, failed = 0;
+    for (size_t i = 0; !atomic_load(&done); i = (i + 1) % h.size()) {
+        handle<counter>::pin p = h[i].lock();
+        if (p) {
+            p->add();
+            ++delivered;
+        }
+        else {
+            ++failed;
+        }
+    }
+    printf("producer: %lu delivered, %lu to destroyed actors\n", (unsigned long)delivered, (unsigned long)failed);
+    return 0;
+}
+
+
+int main() {
+    for (size_t i = 0; i < ACTORS; ++i) {
+        actors[i] = new counter;
+    }
+    for (size_t p = 0; p < PRODUCERS; ++p) {
+        handles[p].assign(actors, actors + ACTORS);
+    }
+
+    vector<pthread_t> threads(PRODUCERS);
+    for (size_t p = 0; p < PRODUCERS; ++p) {
+        pthread_create(&threads[p], NULL, produce, &handles[p]);
+    }
+
+    //destroy and recreate the actors; the producers keep the old handles
+    unsigned long long start = now_ns();
+    for (size_t i = 0; i < CHURN; ++i) {
+        size_t j = i % ACTORS;
+        delete actors[j];
+        actors[j] = new counter;
+    }
+    double secs = (now_ns() - start) / 1e9;
+    atomic_increment(&done);
+
+    for (size_t p = 0; p < PRODUCERS; ++p) {
+        pthread_join(threads[p], NULL);
+    }
+    printf("%lu actors destroyed and recreated in %.3f s: %.0f per second\n", (unsigned long)CHURN, secs, CHURN / secs);
+
+    for (size_t i = 0; i < ACTORS; ++i) {
+        delete actors[i];
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//The example creates many session actors which keep some state,
+//uses them once, and lets them go idle; it reports the memory used
+//while they are active and after they hibernate, and then wakes them up.
+
+
+//number of sessions
+static const size_t SESSIONS = 1000;
+
+
+//idle time before hibernation, in milliseconds
+static const unsigned long IDLE_MS = 100;
+
+
+//returns the resident memory of the process, in bytes
+static long resident() {
+    long size = 0, pages = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    if (fscanf(f, "%ld %ld", &size, &pages) != 2) pages = 0;
+    fclose(f);
+    return pages * sysconf(_SC_PAGESIZE);
+}
+
+
+//a session; its state is a history of events, and a large buffer
+//which can be rebuilt from the history
+class session : public actor {
+public:
+    session() {
+        enable_hibernation(IDLE_MS);
+    }
+
+    ~session() {
+        stop();
+    }
+
+    void event(const string &e) {
+        put(&session::_event, e);
+    }
+
+    result<size_t> size() {
+        return put(&session::_size);
+    }
+
+protected:
+    //saves the history; the buffer is dropped
+    virtual void hibernate(string &blob) {
+        blob = m_history;
+        string().swap(m_history);
+        vector<char>().swap(m_buffer);
+    }
+
+    //restores the history and rebuilds the buffer
+    virtual void rehydrate(const string &blob) {
+        m_history = blob;
+        rebuild();
+    }
+
+private:
+    //events
+    string m_history;
+
+    //working buffer
+    vector<char> m_buffer;
+
+    //adds an event
+    void _event(const string &e) {
+        m_history += e;
+        m_history += '\n';
+        rebuild();
+    }
+
+    //returns the size of the history
+    size_t _size() {
+        return m_history.size();
+    }
+
+    //rebuilds the working buffer
+    void rebuild() {
+        m_buffer.assign(16384, 0);
+        memcpy(&m_buffer[0], m_history.data(), min(m_history.size(), m_buffer.size()));
+    }
+};
+
+
+int main() {
+    long base = resident();
+
+    vector<session *> sessions;
+    for (size_t i = 0; i < SESSIONS; ++i) {
+        sessions.push_back(new session);
+        sessions.back()->event("login");
+    }
+    for (size_t i = 0; i < SESSIONS; ++i) {
+        sessions[i]->size().get();
+    }
+    long active = resident();
+    printf("active:     %8ld KB, %6ld bytes per session\n", (active - base) / 1024, (active - base) / (long)SESSIONS);
+
+    usleep((IDLE_MS * 3) * 1000);
+    long idle = resident();
+    actor::hibernation_stats s = actor::hibernation_statistics();
+    printf("hibernated: %8ld KB, %6ld bytes per session\n", (idle - base) / 1024, (idle - base) / (long)SESSIONS);
+    printf("%ld actors hibernated, %ld bytes of state\n", s.actors, s.bytes);
+
+    size_t total = 0;
+    for (size_t i = 0; i < SESSIONS; ++i) {
+        sessions[i]->event("resume");
+    }
+    for (size_t i = 0; i < SESSIONS; ++i) {
+        total += sessions[i]->size().get();
+    }
+    s = actor::hibernation_statistics();
+    printf("woken up: %ld bytes of history, %ld actors hibernated\n", (long)total, s.actors);
+
+    for (size_t i = 0; i < SESSIONS; ++i) {
+        delete sessions[i];
+    }
+    return 0;
+}
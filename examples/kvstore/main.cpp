@@ -0,0 +1,173 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <sys/time.h>
+#include "kvstore.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//number of records
+static const size_t RECORDS = 100000;
+
+//number of operations per workload
+static const size_t OPERATIONS = 1000000;
+
+//number of operations per batch
+static const size_t BATCH = 64;
+
+
+//returns the current time in seconds
+static double now() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+//zipfian key generator, as in YCSB
+class zipfian {
+public:
+    zipfian(size_t n, double theta = 0.99) : m_n(n), m_theta(theta) {
+        m_zetan = zeta(n, theta);
+        double zeta2 = zeta(2, theta);
+        m_alpha = 1.0 / (1.0 - theta);
+        m_eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / m_zetan);
+    }
+
+    size_t next() {
+        double u = (double)rand() / RAND_MAX;
+        double uz = u * m_zetan;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + pow(0.5, m_theta)) return 1;
+        size_t k = (size_t)(m_n * pow(m_eta * u - m_eta + 1.0, m_alpha));
+        return k < m_n ? k : m_n - 1;
+    }
+
+private:
+    size_t m_n;
+    double m_theta;
+    double m_zetan;
+    double m_alpha;
+    double m_eta;
+
+    static double zeta(size_t n, double theta) {
+        double sum = 0;
+        for (size_t i = 1; i <= n; ++i) sum += 1.0 / pow((double)i, theta);
+        return sum;
+    }
+};
+
+
+//the store type
+typedef kv_store<unsigned, unsigned> store;
+
+
+//runs a workload with single operations
+static double run_single(store &s, zipfian &keys, int read_percent) {
+    double t0 = now();
+    vector<result<pair<bool, unsigned> > > pending;
+    pending.reserve(BATCH);
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+        unsigned k = (unsigned)keys.next();
+        if (rand() % 100 < read_percent) {
+            pending.push_back(s.get(k));
+        }
+        else {
+            s.set(k, (unsigned)i);
+        }
+
+        //keep at most a batch of reads in flight
+        if (pending.size() == BATCH) {
+            for (size_t j = 0; j < pending.size(); ++j) pending[j].get();
+            pending.clear();
+        }
+    }
+    for (size_t j = 0; j < pending.size(); ++j) pending[j].get();
+    return OPERATIONS / (now() - t0);
+}
+
+
+//runs a workload with batched operations
+static double run_batched(store &s, zipfian &keys, int read_percent) {
+    double t0 = now();
+    vector<unsigned> reads;
+    store::items writes;
+    for (size_t i = 0; i < OPERATIONS; i += BATCH) {
+        reads.clear();
+        writes.clear();
+        for (size_t j = 0; j < BATCH; ++j) {
+            unsigned k = (unsigned)keys.next();
+            if (rand() % 100 < read_percent) {
+                reads.push_back(k);
+            }
+            else {
+                writes.push_back(make_pair(k, (unsigned)(i + j)));
+            }
+        }
+        if (!writes.empty()) s.multi_set(writes);
+        if (!reads.empty()) s.multi_get(reads).get();
+    }
+    return OPERATIONS / (now() - t0);
+}
+
+
+int main() {
+    store s;
+    zipfian keys(RECORDS);
+
+    //load
+    store::items items;
+    for (unsigned k = 0; k < RECORDS; ++k) {
+        items.push_back(make_pair(k, k));
+    }
+    s.multi_set(items);
+
+    //workloads
+    struct workload {
+        const char *name;
+        int read_percent;
+    } workloads[] = {
+        {"A (50% read, 50% update)", 50},
+        {"B (95% read, 5% update) ", 95},
+        {"C (100% read)           ", 100}
+    };
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+        double single = run_single(s, keys, workloads[w].read_percent);
+        double batched = run_batched(s, keys, workloads[w].read_percent);
+        printf("workload %s: single %10.0f ops/s, batched %10.0f ops/s\n", workloads[w].name, single, batched);
+    }
+
+    //snapshot reads
+    store::snapshot_type snap = s.snapshot();
+    double t0 = now();
+    unsigned found = 0, v;
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+        found += snap.find((unsigned)keys.next(), v);
+    }
+    printf("snapshot reads: %10.0f ops/s (%u of %u entries found)\n", OPERATIONS / (now() - t0), found, (unsigned)OPERATIONS);
+
+    //a shard stopped while multi-gets are in flight: the multi-gets queued
+    //before the stop complete, and the ones after fail, instead of waiting forever
+    vector<unsigned> batch;
+    for (unsigned k = 0; k < BATCH; ++k) batch.push_back(k);
+    vector<result<store::values> > pending;
+    for (size_t i = 0; i < 1000; ++i) {
+        if (i == 500) s[0].stop();
+        pending.push_back(s.multi_get(batch));
+    }
+    size_t completed = 0, failed = 0;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        try {
+            pending[i].get();
+            ++completed;
+        }
+        catch (const actor_error &) {
+            ++failed;
+        }
+    }
+    printf("multi-gets with a stopped shard: %u completed, %u failed\n", (unsigned)completed, (unsigned)failed);
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//The benchmark offers a service actor 80% of its capacity, then a spike
+//of three times its capacity, then 80% again, and measures how long
+//the requests put after the spike take, with no load shedding, with
+//a message time to live, with admission control, and with both.
+
+
+//time a request takes to execute, in nanoseconds
+static const unsigned long long SERVICE_NS = 200000;
+
+
+//phases: duration in milliseconds, and requests per second
+static const unsigned long PHASE_MS[3] = { 1000, 500, 1500 };
+static const double PHASE_RATE[3] = { 4000, 15000, 4000 };
+
+
+//a service actor; it records the latency of each request it executes
+class service : public actor {
+public:
+    service(unsigned long ttl_ms, unsigned long max_wait_ms) {
+        set_message_ttl(ttl_ms);
+        set_admission_limit(max_wait_ms);
+    }
+
+    ~service() {
+        stop();
+    }
+
+    void request(unsigned long long t) {
+        put(&service::_request, t);
+    }
+
+    result<vector<pair<unsigned long long, unsigned long long> > > latencies() {
+        return put(&service::_latencies);
+    }
+
+private:
+    //time each request was put, and its latency
+    vector<pair<unsigned long long, unsigned long long> > m_latencies;
+
+    void _request(const unsigned long long &t) {
+        unsigned long long start = now_ns();
+        while (now_ns() - start < SERVICE_NS) {}
+        m_latencies.push_back(make_pair(t, now_ns() - t));
+    }
+
+    vector<pair<unsigned long long, unsigned long long> > _latencies() {
+        return m_latencies;
+    }
+};
+
+
+//runs the phases against a service with the given policy
+static void run(const char *name, unsigned long ttl_ms, unsigned long max_wait_ms) {
+    service s(ttl_ms, max_wait_ms);
+    unsigned long long start = now_ns(), phase_end = start, spike_end = 0;
+    size_t offered = 0;
+    for (int p = 0; p < 3; ++p) {
+        unsigned long long phase_start = phase_end;
+        phase_end = phase_start + PHASE_MS[p] * 1000000ULL;
+
+        //each millisecond, put the requests due, then sleep
+        double interval = 1e9 / PHASE_RATE[p];
+        size_t i = 0;
+        for (unsigned long long tick = phase_start; tick < phase_end; tick += 1000000ULL) {
+            unsigned long long now = now_ns();
+            if (now < tick) usleep((useconds_t)((tick - now) / 1000));
+            for (; phase_start + (unsigned long long)(i * interval) < tick + 1000000ULL; ++i) {
+                s.request(now_ns());
+                ++offered;
+            }
+        }
+        if (p == 1) spike_end = phase_end;
+    }
+
+    //let the queue drain, so as that the query is not rejected
+    usleep(100000);
+    vector<pair<unsigned long long, unsigned long long> > l = s.latencies();
+    actor::shedding_stats st = s.shedding_statistics();
+
+    //latency of the requests put after the spike, and time to recover
+    vector<unsigned long long> after;
+    unsigned long long recovered = 0;
+    for (size_t i = 0; i < l.size(); ++i) {
+        if (l[i].first < spike_end) continue;
+        after.push_back(l[i].second);
+        if (l[i].second > 10000000ULL) recovered = l[i].first - spike_end;
+    }
+    sort(after.begin(), after.end());
+    double p50 = after.empty() ? 0 : after[after.size() / 2] / 1e6;
+    double p99 = after.empty() ? 0 : after[after.size() * 99 / 100] / 1e6;
+    printf("%-12s %7lu %9lu %8ld %8ld %10.2f %10.2f %12.0f\n", name, (unsigned long)offered, (unsigned long)l.size(),
+        st.expired, st.rejected, p50, p99, recovered / 1e6);
+}
+
+
+int main() {
+    printf("%-12s %7s %9s %8s %8s %10s %10s %12s\n", "policy", "offered", "executed", "expired", "rejected",
+        "p50 ms", "p99 ms", "recovery ms");
+    run("none", 0, 0);
+    run("ttl 20ms", 20, 0);
+    run("admit 10ms", 0, 10);
+    run("both", 20, 10);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sys/time.h>
+#include "parallel.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//number of iterations
+static const size_t N = 20000000;
+
+
+//returns the current time in seconds
+static double now() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+//the computation of one element
+static double element(size_t i) {
+    return sqrt((double)i) * sin((double)i);
+}
+
+
+//computes the elements of an output array
+class compute {
+public:
+    compute(vector<double> &out) : m_out(&out) {}
+
+    void operator ()(size_t i) const {
+        (*m_out)[i] = element(i);
+    }
+
+private:
+    vector<double> *m_out;
+};
+
+
+//computes the sum of the slice of a worker
+class slice_sum {
+public:
+    slice_sum(size_t workers) : m_workers(workers) {}
+
+    double operator ()(size_t w) const {
+        double sum = 0;
+        for (size_t i = w; i < N; i += m_workers) {
+            sum += element(i);
+        }
+        return sum;
+    }
+
+private:
+    size_t m_workers;
+};
+
+
+//adds two values
+struct add {
+    double operator ()(const double &a, const double &b) const {
+        return a + b;
+    }
+};
+
+
+//runs the benchmark on the given group
+static void bench(worker_group &group) {
+    vector<double> out(N);
+
+    double t0 = now();
+    parallel_for(0, N, group, compute(out));
+    double t1 = now();
+    double sum = scatter_gather<double>(group, slice_sum(group.size()), add()).get();
+    double t2 = now();
+
+    printf("%3u worker(s): parallel_for %8.3f ms, scatter_gather %8.3f ms (sum %g)\n",
+        (unsigned)group.size(), (t1 - t0) * 1000, (t2 - t1) * 1000, sum);
+}
+
+
+int main() {
+    //single actor baseline
+    worker_group single(1);
+    bench(single);
+
+    //one worker per processor
+    worker_group all;
+    bench(all);
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include "typed.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//a reply, with the id of its request
+struct reply {
+    long long id;
+    double value;
+};
+
+
+//another message, left in the mailbox by selective receive
+struct event {
+    int source;
+};
+
+
+//asks the actor to select the replies with ids 0 to count - 1, in this order
+struct collect {
+    long long count;
+    result<double> sum;
+};
+
+
+//replies are selected by id
+namespace actorlib {
+    template <> struct message_key<reply> {
+        static long long get(const reply &r) {
+            return r.id;
+        }
+    };
+}
+
+
+//collects replies which arrive out of order, among other messages
+class collector : public typed_actor<collector, collect, reply, event> {
+public:
+    collector() : m_events(0) {}
+
+    ~collector() {
+        stop();
+    }
+
+private:
+    friend class typed_actor<collector, collect, reply, event>;
+
+    long m_events;
+
+    void receive(collect &c) {
+        double sum = 0;
+        for (long long id = 0; id < c.count; ++id) {
+            reply r;
+            if (!select_message(r, id, 1000)) {
+                c.sum.fail("reply timeout");
+                return;
+            }
+            sum += r.value;
+        }
+        c.sum.set(sum);
+    }
+
+    void receive(const reply &) {
+    }
+
+    void receive(const event &) {
+        ++m_events;
+    }
+};
+
+
+//sends the replies shuffled, each followed by an event, and collects them in order
+static void run(long long count) {
+    vector<long long> ids((size_t)count);
+    for (long long i = 0; i < count; ++i) {
+        ids[(size_t)i] = i;
+    }
+    random_shuffle(ids.begin(), ids.end());
+
+    collector c;
+    collect request;
+    request.count = count;
+    unsigned long long start = now_ns();
+    c.send(request);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        reply r = { ids[i], 1.0 };
+        c.send(r);
+        event e = { (int)i };
+        c.send(e);
+    }
+    double sum = request.sum.get();
+    unsigned long long ns = now_ns() - start;
+    printf("%8lld replies: sum %.0f in %.3f s, %.0f ns per reply\n", count, sum, ns / 1e9, (double)ns / count);
+}
+
+
+int main() {
+    run(10000);
+    run(100000);
+    run(1000000);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <unistd.h>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//The benchmark puts requests to an actor before it is initialized;
+//the actor defers them until the initialization message arrives,
+//either by putting them again, or by stashing them.
+
+
+//number of requests
+static const size_t MESSAGES = 1000000;
+
+
+//defers requests by putting them again
+class reput_actor : public actor {
+public:
+    reput_actor() : m_ready(false), m_sum(0) {}
+
+    ~reput_actor() {
+        stop();
+    }
+
+    void request(int v) {
+        put(&reput_actor::_request, v);
+    }
+
+    void init() {
+        put(&reput_actor::_init);
+    }
+
+    result<long> sum() {
+        return put(&reput_actor::_sum);
+    }
+
+private:
+    bool m_ready;
+    long m_sum;
+
+    void _request(const int &v) {
+        if (!m_ready) {
+            put(&reput_actor::_request, v);
+            return;
+        }
+        m_sum += v;
+    }
+
+    void _init() {
+        m_ready = true;
+    }
+
+    long _sum() {
+        return m_sum;
+    }
+};
+
+
+//defers requests by stashing them
+class stash_actor : public actor {
+public:
+    stash_actor() : m_ready(false), m_sum(0) {}
+
+    ~stash_actor() {
+        stop();
+    }
+
+    void request(int v) {
+        put(&stash_actor::_request, v);
+    }
+
+    void init() {
+        put(&stash_actor::_init);
+    }
+
+    result<long> sum() {
+        return put(&stash_actor::_sum);
+    }
+
+private:
+    bool m_ready;
+    long m_sum;
+
+    void _request(const int &v) {
+        if (!m_ready) {
+            stash();
+            return;
+        }
+        m_sum += v;
+    }
+
+    void _init() {
+        m_ready = true;
+        unstash_all();
+    }
+
+    long _sum() {
+        return m_sum;
+    }
+};
+
+
+//puts the requests, then the initialization, and waits for the sum;
+//re-put requests are queued behind later messages, so the sum is polled
+template <class A> static void run(const char *name) {
+    A a;
+    unsigned long long start = now_ns();
+    for (size_t i = 0; i < MESSAGES; ++i) {
+        a.request(1);
+    }
+    a.init();
+    long sum;
+    while ((sum = a.sum().get()) < (long)MESSAGES) {
+        usleep(1000);
+    }
+    printf("%-6s %ld requests in %.3f s\n", name, sum, (now_ns() - start) / 1e9);
+}
+
+
+int main() {
+    run<reput_actor>("re-put");
+    run<stash_actor>("stash");
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <vector>
+#include <sys/time.h>
+#include "strand.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//Tokens are passed around a ring of nodes; each node counts the tokens
+//which pass through it, serialized by a strand of its own. The strands
+//share a pool of threads, so the ring needs no thread per node, and the
+//tokens are the tasks, so passing them allocates nothing.
+
+
+//number of nodes
+static const size_t NODES = 10000;
+
+
+//number of tokens
+static const size_t TOKENS = 100;
+
+
+//number of hops of each token
+static const size_t HOPS = 100000;
+
+
+//returns the current time in seconds
+static double now() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+class token;
+
+
+//a node of the ring
+class node {
+public:
+    node(strand_pool &pool) : m_strand(pool), m_next(0), m_count(0) {}
+
+    //the strand of the node
+    strand m_strand;
+
+    //the next node
+    node *m_next;
+
+    //number of tokens passed through the node; only used by the strand
+    size_t m_count;
+};
+
+
+//a token
+class token : public strand::task {
+public:
+    token(node *n, size_t hops, result<int> done) : m_node(n), m_hops(hops), m_done(done) {}
+
+    //passes the token to the next node
+    virtual void run() {
+        ++m_node->m_count;
+        if (--m_hops == 0) {
+            m_done.set(1);
+            return;
+        }
+        m_node = m_node->m_next;
+        m_node->m_strand.post(this);
+    }
+
+private:
+    node *m_node;
+    size_t m_hops;
+    result<int> m_done;
+};
+
+
+int main() {
+    strand_pool pool;
+
+    vector<node *> nodes;
+    for (size_t i = 0; i < NODES; ++i) {
+        nodes.push_back(new node(pool));
+    }
+    for (size_t i = 0; i < NODES; ++i) {
+        nodes[i]->m_next = nodes[(i + 1) % NODES];
+    }
+
+    vector<token *> tokens;
+    vector<result<int> > done;
+    double t0 = now();
+    for (size_t i = 0; i < TOKENS; ++i) {
+        node *n = nodes[i * NODES / TOKENS];
+        done.push_back(result<int>());
+        tokens.push_back(new token(n, HOPS, done.back()));
+        n->m_strand.post(tokens.back());
+    }
+    for (size_t i = 0; i < TOKENS; ++i) {
+        done[i].get();
+    }
+    double t1 = now();
+
+    size_t count = 0;
+    for (size_t i = 0; i < NODES; ++i) {
+        count += nodes[i]->m_count;
+    }
+    printf("%u threads, %u hops, %.0f hops/s\n", (unsigned)pool.size(), (unsigned)count, count / (t1 - t0));
+    printf("sizeof(strand) %u, sizeof(actor) %u\n", (unsigned)sizeof(strand), (unsigned)sizeof(actor));
+
+    for (size_t i = 0; i < TOKENS; ++i) {
+        delete tokens[i];
+    }
+    for (size_t i = 0; i < NODES; ++i) {
+        delete nodes[i];
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <cstdio>
+#include <sched.h>
+#include <sys/time.h>
+#include "stream.hpp"
+using namespace std;
+using namespace actorlib;
+using namespace actorlib::stream;
+
+
+//The benchmark pushes items through a chain of 8 map and filter
+//operators: first as 8 stage actors, with a message per operator
+//and item, then fused into one stage actor, with a message per item.
+
+
+//number of items
+static const int ITEMS = 1000000;
+
+
+//returns the current time in seconds
+static double now() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+//the map operator
+struct add_one {
+    int operator ()(const int &v) const {
+        return v + 1;
+    }
+};
+
+
+//the filter operator
+struct not_multiple_of_1000 {
+    bool operator ()(const int &v) const {
+        return v % 1000 != 0;
+    }
+};
+
+
+typedef map_stage<int, int, add_one> inc_stage;
+typedef filter_stage<int, not_multiple_of_1000> keep_stage;
+
+
+//the end of the chain, which counts the items it receives
+class counter : public sink<int> {
+public:
+    counter() : m_count(0) {}
+
+    void push(const int &) {
+        atomic_increment(&m_count);
+    }
+
+    long count() const {
+        return atomic_load(&m_count);
+    }
+
+private:
+    volatile long m_count;
+};
+
+
+//pushes the items to the start of a chain, and returns the items per second
+//when the given number of them has reached the end
+static double measure(sink<int> &start, const counter &end, long expected) {
+    double t0 = now();
+    for (int i = 0; i < ITEMS; ++i) {
+        start.push(i);
+    }
+    while (end.count() < expected) sched_yield();
+    double t1 = now();
+    return ITEMS / (t1 - t0);
+}
+
+
+//runs a stage in one actor, and returns the items per second
+template <class S> double measure_fused(const S &s, long expected) {
+    counter end;
+    stage_actor<S> a(s, end);
+    return measure(a, end, expected);
+}
+
+
+int main() {
+    inc_stage inc = stream::map<int, int>(add_one());
+    keep_stage keep = stream::filter<int>(not_multiple_of_1000());
+
+    //the 8 operators fused into one stage
+    fused_stage<inc_stage, keep_stage> pair = fuse(inc, keep);
+    fused_stage<fused_stage<inc_stage, keep_stage>, fused_stage<inc_stage, keep_stage> > quad = fuse(pair, pair);
+    fused_stage<fused_stage<fused_stage<inc_stage, keep_stage>, fused_stage<inc_stage, keep_stage> >,
+        fused_stage<fused_stage<inc_stage, keep_stage>, fused_stage<inc_stage, keep_stage> > > chain = fuse(quad, quad);
+
+    //the items which pass the chain
+    long expected = 0;
+    for (int i = 0; i < ITEMS; ++i) {
+        int out;
+        if (chain(i, out)) ++expected;
+    }
+
+    //one actor per operator
+    double separate;
+    {
+        counter end;
+        stage_actor<keep_stage> s8(keep, end);
+        stage_actor<inc_stage> s7(inc, s8);
+        stage_actor<keep_stage> s6(keep, s7);
+        stage_actor<inc_stage> s5(inc, s6);
+        stage_actor<keep_stage> s4(keep, s5);
+        stage_actor<inc_stage> s3(inc, s4);
+        stage_actor<keep_stage> s2(keep, s3);
+        stage_actor<inc_stage> s1(inc, s2);
+        separate = measure(s1, end, expected);
+    }
+
+    double fused = measure_fused(chain, expected);
+
+    printf("8 operators, %d items, %ld pass\n", ITEMS, expected);
+    printf("separate stage actors: %10.0f items/s\n", separate);
+    printf("fused stage actor:     %10.0f items/s\n", fused);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+#include "actorlib.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//The benchmark measures the cost of a throttle which does not limit,
+//and then puts a burst of messages to an actor limited to a fixed rate,
+//with each of the modes for the excess messages.
+
+
+//number of messages for measuring the overhead
+static const size_t MESSAGES = 1000000;
+
+
+//the limited rate, in calls per second, and the burst
+static const double RATE = 2000;
+static const double BURST = 50;
+
+
+//number of messages for the limited rate
+static const size_t BURST_MESSAGES = 4000;
+
+
+//a downstream client; it records when the first and last calls are executed
+class client : public actor {
+public:
+    client(throttle *t, throttle_mode mode, timer *tm) : m_calls(0), m_first(0), m_last(0) {
+        if (t) set_throttle(t, mode, tm);
+    }
+
+    ~client() {
+        stop();
+    }
+
+    void call() {
+        put(&client::_call);
+    }
+
+    result<size_t> calls() {
+        return put(&client::_calls);
+    }
+
+    result<double> duration() {
+        return put(&client::_duration);
+    }
+
+private:
+    size_t m_calls;
+    unsigned long long m_first;
+    unsigned long long m_last;
+
+    void _call() {
+        m_last = now_ns();
+        if (!m_calls++) m_first = m_last;
+    }
+
+    size_t _calls() {
+        return m_calls;
+    }
+
+    double _duration() {
+        return (m_last - m_first) / 1e9;
+    }
+};
+
+
+//measures the time of putting messages
+static double put_rate(throttle *t) {
+    client c(t, actor::THROTTLE_REJECT, 0);
+    unsigned long long start = now_ns();
+    for (size_t i = 0; i < MESSAGES; ++i) {
+        c.call();
+    }
+    c.calls().get();
+    return MESSAGES / ((now_ns() - start) / 1e9);
+}
+
+
+//puts a burst of messages with the given mode
+static void burst(const char *name, actor::throttle_mode mode) {
+    timer tm;
+    throttle t(RATE, BURST);
+    client c(&t, mode, &tm);
+    unsigned long long start = now_ns();
+    for (size_t i = 0; i < BURST_MESSAGES; ++i) {
+        c.call();
+    }
+    double put_secs = (now_ns() - start) / 1e9;
+
+    //the queries are limited too: after a rejected burst, wait for the
+    //throttle to allow them; a delayed query is executed after the burst
+    if (mode == actor::THROTTLE_REJECT) usleep(100000);
+    size_t calls = c.calls();
+    double secs = c.duration();
+    printf("%-8s put in %6.3f s, %5lu executed in %6.3f s: %7.0f calls per second, %ld rejected\n",
+        name, put_secs, (unsigned long)calls, secs, calls > 1 ? (calls - 1) / secs : 0.0, c.shedding_statistics().throttled);
+}
+
+
+int main() {
+    throttle unlimited(1e12, 1e6);
+    unsigned long long start = now_ns();
+    for (size_t i = 0; i < MESSAGES; ++i) {
+        unlimited.try_acquire();
+    }
+    printf("throttle check:      %10.1f ns per call\n", (double)(now_ns() - start) / MESSAGES);
+
+    //the best of a few runs, alternated, since a run is short
+    double free_rate = 0, throttled_rate = 0;
+    for (int i = 0; i < 5; ++i) {
+        free_rate = max(free_rate, put_rate(0));
+        throttled_rate = max(throttled_rate, put_rate(&unlimited));
+    }
+    printf("no throttle:         %10.0f puts per second\n", free_rate);
+    printf("throttle, unlimited: %10.0f puts per second, %.1f%% overhead\n", throttled_rate, 100 * (free_rate / throttled_rate - 1));
+
+    printf("limit %.0f calls per second, burst %.0f, %lu calls:\n", RATE, BURST, (unsigned long)BURST_MESSAGES);
+    burst("reject", actor::THROTTLE_REJECT);
+    burst("block", actor::THROTTLE_BLOCK);
+    burst("delay", actor::THROTTLE_DELAY);
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <string>
+#include "typed.hpp"
+using namespace std;
+using namespace actorlib;
+
+
+//number of readings
+static const int READINGS = 1000000;
+
+
+//a reading of a sensor
+struct reading {
+    int sensor;
+    double value;
+};
+
+
+//a label for a sensor
+struct label {
+    int sensor;
+    string text;
+};
+
+
+//asks for the total of the readings
+struct total {
+    result<double> value;
+};
+
+
+//receives the readings as pointer-to-member messages
+class member_actor : public actor {
+public:
+    member_actor() : m_total(0) {}
+
+    ~member_actor() {
+        stop();
+    }
+
+    void add(const reading &s) {
+        put(&member_actor::_add, s);
+    }
+
+    result<double> get_total() {
+        return put(&member_actor::_get_total);
+    }
+
+private:
+    double m_total;
+
+    void _add(const reading &s) {
+        m_total += s.value;
+    }
+
+    double _get_total() {
+        return m_total;
+    }
+};
+
+
+//receives the readings by value
+class typed_sensor : public typed_actor<typed_sensor, reading, label, total> {
+public:
+    typed_sensor() : m_total(0) {}
+
+    ~typed_sensor() {
+        stop();
+    }
+
+private:
+    friend class typed_actor<typed_sensor, reading, label, total>;
+
+    double m_total;
+    string m_label;
+
+    void receive(const reading &s) {
+        m_total += s.value;
+    }
+
+    void receive(label &l) {
+        m_label.swap(l.text);
+    }
+
+    void receive(total &t) {
+        t.value.set(m_total);
+    }
+};
+
+
+//prints the time
+static void print(const char *name, double value, unsigned long long start) {
+    printf("%-16s total %.0f in %.3f s\n", name, value, (now_ns() - start) / 1e9);
+}
+
+
+int main() {
+    {
+        member_actor a;
+        unsigned long long start = now_ns();
+        for (int i = 0; i < READINGS; ++i) {
+            reading r = { i % 16, 1.0 };
+            a.add(r);
+        }
+        print("pointer-to-member", a.get_total().get(), start);
+    }
+
+    {
+        typed_sensor a;
+        unsigned long long start = now_ns();
+        label l = { 0, "sensor 0" };
+        a.send(l);
+        for (int i = 0; i < READINGS; ++i) {
+            reading r = { i % 16, 1.0 };
+            a.send(r);
+        }
+        total t;
+        a.send(t);
+        print("typed", t.value.get(), start);
+    }
+
+    return 0;
+}
@@ -1,73 +1,1398 @@
-#include <cassert>
-#include "actorlib.hpp"
-
-
-namespace actorlib {
-
-
-/** constructs an actor.
-    The internal thread is started.
- */
-actor::actor() {
-    m_loop = true;
-    pthread_mutex_init(&m_mutex, NULL);
-    sem_init(&m_sem, 0, 0);
-    pthread_create(&m_thread, NULL, thread_proc, this);
-}
-
-
-/** destroys an actor.
-    The calling thread blocks until the actor thread is terminated.
- */
-actor::~actor() {
-    exit();
-    pthread_join(m_thread, NULL);
-    sem_destroy(&m_sem);
-    pthread_mutex_destroy(&m_mutex);    
-}
-
-
-//puts a message in the message queue, synchronized
-void actor::put(message *msg) {
-    pthread_mutex_lock(&m_mutex);
-    m_messages.push_back(msg);
-    pthread_mutex_unlock(&m_mutex);    
-    sem_post(&m_sem);
-}
-
-
-//exit
-void actor::_exit() {
-    m_loop = false;
-}
-
-
-//the message handling loop
-void actor::run() {
-    //while the loop is active
-    while (m_loop) {
-        //wait for message
-        sem_wait(&m_sem);
-        
-        //get a message (synchronized block)
-        pthread_mutex_lock(&m_mutex);
-        assert(!m_messages.empty());
-        message_ptr msg = m_messages.front();
-        m_messages.pop_front();
-        pthread_mutex_unlock(&m_mutex);
-        
-        //execute the message
-        msg->exec();
-        delete msg;
-    }
-}
-
-
-//internal function which calls the thread's run function
-void *actor::thread_proc(void *arg) {
-    reinterpret_cast<actor *>(arg)->run();
-    return 0;
-}
-
-
-} //namespace actorlib
+#include <cerrno>
+#include <ctime>
+#include <sched.h>
+#include "actorlib.hpp"
+
+
+namespace actorlib {
+
+
+//hibernation statistics
+static volatile long hibernated_actors = 0;
+static volatile long hibernated_bytes = 0;
+
+
+//a slot of the handle table; each one in its own cache line,
+//since the pin count is written by the threads which put to the actor
+struct actor_slot {
+    //number of pins
+    volatile long m_pins;
+
+    //generation; odd while an actor has the slot
+    volatile long m_generation;
+
+    //actor
+    actor *volatile m_actor;
+
+    //next free slot, plus 1; 0 for the end of the list
+    volatile long m_next_free;
+
+    //padding up to the cache line
+    char m_pad[ACTORLIB_CACHE_LINE_SIZE];
+};
+
+
+//the handle table is an array of segments, allocated when needed,
+//so as that slots are never moved or freed
+enum {
+    SLOT_SEGMENT_SIZE = 4096,
+    SLOT_SEGMENT_COUNT = 4096
+};
+static actor_slot *volatile slot_segments[SLOT_SEGMENT_COUNT];
+static pthread_mutex_t slot_segment_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+//number of slots ever taken
+static volatile long slot_count = 0;
+
+
+//head of the list of free slots: a tag in the high 32 bits, against ABA,
+//and the index of the first free slot, plus 1, in the low 32 bits
+static volatile long long slot_free_list = 0;
+
+
+//returns the slot with the given index
+static actor_slot &get_slot(unsigned long index) {
+    return slot_segments[index / SLOT_SEGMENT_SIZE][index % SLOT_SEGMENT_SIZE];
+}
+
+
+//takes a slot from the free list; returns false if the list is empty
+static bool pop_free_slot(unsigned long &index) {
+    for (;;) {
+        long long head = atomic_load(&slot_free_list);
+        unsigned long first = (unsigned long)(head & 0xffffffff);
+        if (!first) return false;
+        long long next = ((head >> 32) + 1) << 32 | (unsigned long)atomic_load(&get_slot(first - 1).m_next_free);
+        if (atomic_compare_exchange(&slot_free_list, head, next)) {
+            index = first - 1;
+            return true;
+        }
+    }
+}
+
+
+//puts a slot in the free list
+static void push_free_slot(unsigned long index) {
+    for (;;) {
+        long long head = atomic_load(&slot_free_list);
+        get_slot(index).m_next_free = (long)(head & 0xffffffff);
+        long long next = ((head >> 32) + 1) << 32 | (index + 1);
+        if (atomic_compare_exchange(&slot_free_list, head, next)) return;
+    }
+}
+
+
+//takes a slot never used before, allocating its segment if needed
+static unsigned long new_slot() {
+    unsigned long index = (unsigned long)atomic_increment(&slot_count) - 1;
+    size_t s = index / SLOT_SEGMENT_SIZE;
+    if (s >= SLOT_SEGMENT_COUNT) throw std::bad_alloc();
+    if (!slot_segments[s]) {
+        pthread_mutex_lock(&slot_segment_mutex);
+        if (!slot_segments[s]) {
+            actor_slot *segment = new actor_slot[SLOT_SEGMENT_SIZE];
+            for (size_t i = 0; i < SLOT_SEGMENT_SIZE; ++i) {
+                segment[i].m_pins = 0;
+                segment[i].m_generation = 0;
+                segment[i].m_actor = 0;
+                segment[i].m_next_free = 0;
+            }
+            slot_segments[s] = segment;
+        }
+        pthread_mutex_unlock(&slot_segment_mutex);
+    }
+    return index;
+}
+
+
+/** constructs an actor.
+    The internal thread is started.
+ */
+actor::actor(memory_resource *mr) : m_scratch(mr), m_resource(mr) {
+    m_loop = true;
+    m_stopped = false;
+    m_terminated = false;
+    m_supervisor = 0;
+    m_behavior = 0;
+    m_stash_current = false;
+    m_batching = 0;
+    m_expired = 0;
+    m_ttl = 0;
+    m_max_wait = 0;
+    m_wait = 0;
+    m_rejected = 0;
+    m_throttle = 0;
+    m_throttle_mode = THROTTLE_REJECT;
+    m_throttle_timer = 0;
+    m_throttled = 0;
+    m_idle_timeout = 0;
+    m_rehydrate = false;
+    m_publication_slots = 0;
+    m_publication_count = 0;
+    m_publication_memory = 0;
+    m_signalled = 0;
+    m_closed = 0;
+    m_sub_queues = 0;
+    m_active = 0;
+    m_active_head = 0;
+    m_active_size = 0;
+    m_turns = 0;
+    m_quantum = 0;
+    m_state = RUNNING;
+    acquire_slot();
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_mutex_init(&m_thread_mutex, NULL);
+    sem_init(&m_sem, 0, 0);
+    pthread_create(&m_thread, NULL, thread_proc, this);
+}
+
+
+/** destroys an actor.
+    The calling thread blocks until the actor thread is terminated.
+ */
+actor::~actor() {
+    stop();
+    release_slot();
+    clear(m_pending);
+    clear(m_messages);
+    delete[] m_publication_memory;
+    delete[] m_sub_queues;
+    delete[] m_active;
+    sem_destroy(&m_sem);
+    pthread_mutex_destroy(&m_thread_mutex);
+    pthread_mutex_destroy(&m_mutex);    
+}
+
+
+//returns the hibernation statistics
+actor::hibernation_stats actor::hibernation_statistics() {
+    hibernation_stats s;
+    s.actors = atomic_load(&hibernated_actors);
+    s.bytes = atomic_load(&hibernated_bytes);
+    return s;
+}
+
+
+//returns the load shedding statistics of the actor
+actor::shedding_stats actor::shedding_statistics() const {
+    shedding_stats s;
+    s.expired = atomic_load(&m_expired);
+    s.rejected = atomic_load(&m_rejected);
+    s.throttled = atomic_load(&m_throttled);
+    return s;
+}
+
+
+//puts the exit message and waits for the actor thread to terminate
+void actor::stop() {
+    if (m_stopped) return;
+
+    //no handle resolves, and no pin remains, before the derived destructors
+    //which call this destroy their members
+    invalidate_slot();
+
+    //a hibernated or terminated actor has no thread running, and it is not woken up
+    pthread_mutex_lock(&m_mutex);
+    state prev = m_state;
+    m_state = STOPPED;
+    pthread_mutex_unlock(&m_mutex);
+    if (prev != HIBERNATED && prev != FAILED) exit();
+
+    pthread_mutex_lock(&m_thread_mutex);
+    pthread_join(m_thread, NULL);
+    pthread_mutex_unlock(&m_thread_mutex);
+
+    if (prev == HIBERNATED) {
+        atomic_add(&hibernated_actors, -1);
+        atomic_add(&hibernated_bytes, -(long)m_blob.size());
+        std::string().swap(m_blob);
+    }
+
+    //fail the messages left, and any message put from now on
+    pthread_mutex_lock(&m_mutex);
+    m_state = DEAD;
+    m_pending.splice_back(m_messages);
+    pthread_mutex_unlock(&m_mutex);
+    if (m_publication_slots) {
+        atomic_store(&m_closed, 1);
+        flush_sub_queues(m_pending);
+        gather(m_pending);
+    }
+    clear(m_stash);
+    clear(m_pending);
+
+    m_stopped = true;
+}
+
+
+//puts a message in the message queue, synchronized
+void actor::put(message *msg, put_mode mode) {
+    if (m_throttle && mode == PUT_BACK && !apply_throttle(msg)) return;
+
+    if (mode == PUT_BACK || mode == PUT_DELAYED) {
+        //while the queue wait exceeds the target, reject the message
+        long max_wait = atomic_load(&m_max_wait);
+        if (max_wait && atomic_load(&m_wait) > max_wait) {
+            atomic_increment(&m_rejected);
+            msg->fail("actor overloaded");
+            msg->release();
+            return;
+        }
+
+        //stamp the message, if its wait is measured or it may expire
+        long ttl = atomic_load(&m_ttl);
+        if (max_wait || ttl || msg->m_deadline) {
+            msg->m_time = now_ns();
+            if (ttl && !msg->m_deadline) msg->m_deadline = msg->m_time + ttl * 1000ULL;
+        }
+    }
+
+    bool front = mode == PUT_FRONT;
+    if (m_publication_slots && !front) {
+        publish(msg);
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+
+    //a terminated actor fails the message
+    if (m_state == DEAD || (m_state == FAILED && !front)) {
+        pthread_mutex_unlock(&m_mutex);
+        msg->fail("actor terminated");
+        msg->release();
+        return;
+    }
+
+    bool wake = m_messages.empty();
+    if (front) m_messages.push_front(msg); else m_messages.push_back(msg);
+    bool hibernated = m_state == HIBERNATED;
+    bool failed = m_state == FAILED;
+    if (hibernated || failed) m_state = RUNNING;
+    if (failed && m_publication_slots) atomic_store(&m_closed, 0);
+    pthread_mutex_unlock(&m_mutex);
+
+    if (hibernated || failed) start(hibernated);
+
+    //the actor thread takes all the messages at once,
+    //so it only needs to be woken up for the first one
+    if (wake) sem_post(&m_sem);
+}
+
+
+//exit
+void actor::_exit() {
+    //with publication slots, messages published by other threads before
+    //the exit message may follow it, or be not gathered yet: execute them first
+    if (m_publication_slots) {
+        flush_sub_queues(m_pending);
+        gather(m_pending);
+        m_pending.push_back(new (m_resource) object_message_0<actor, void>(this, result<void>(), &actor::_exit_published));
+        return;
+    }
+    m_loop = false;
+}
+
+
+//exit, after the messages published before the exit message
+void actor::_exit_published() {
+    m_loop = false;
+}
+
+
+//key of the index of the calling thread, which selects its publication slot
+static pthread_key_t producer_key;
+static pthread_once_t producer_key_once = PTHREAD_ONCE_INIT;
+
+
+//number of threads which have published messages
+static volatile long producer_count = 0;
+
+
+//creates the key of the producer index
+static void create_producer_key() {
+    pthread_key_create(&producer_key, NULL);
+}
+
+
+//sets the sender group of the calling thread
+void actor::set_sender_group(unsigned long group) {
+    pthread_once(&producer_key_once, create_producer_key);
+    pthread_setspecific(producer_key, reinterpret_cast<void *>((size_t)group + 1));
+}
+
+
+//returns the index of the calling thread, assigned on its first publication
+static unsigned long producer_index() {
+    pthread_once(&producer_key_once, create_producer_key);
+    void *p = pthread_getspecific(producer_key);
+    if (!p) {
+        p = reinterpret_cast<void *>((size_t)atomic_increment(&producer_count));
+        pthread_setspecific(producer_key, p);
+    }
+    return (unsigned long)reinterpret_cast<size_t>(p) - 1;
+}
+
+
+//gives the actor a mailbox of publication slots
+void actor::enable_publication_slots(unsigned long count) {
+    if (m_publication_slots || !count) return;
+
+    //one more slot, so as that the slots can be aligned to the cache line
+    m_publication_memory = new char[(count + 1) * sizeof(publication_slot)];
+    size_t misalignment = reinterpret_cast<size_t>(m_publication_memory) % ACTORLIB_CACHE_LINE_SIZE;
+    size_t offset = misalignment ? ACTORLIB_CACHE_LINE_SIZE - misalignment : 0;
+    publication_slot *slots = reinterpret_cast<publication_slot *>(m_publication_memory + offset);
+    for (unsigned long i = 0; i < count; ++i) {
+        slots[i].m_head = 0;
+    }
+    m_publication_count = count;
+    m_publication_slots = slots;
+}
+
+
+//makes the actor execute the messages of its senders in turn
+void actor::enable_fair_queuing(unsigned long quantum, unsigned long count) {
+    if (m_sub_queues) return;
+    enable_publication_slots(count);
+    if (!m_publication_slots) return;
+    m_active = new unsigned long[m_publication_count];
+    m_quantum = quantum ? quantum : 1;
+    m_sub_queues = new message_list[m_publication_count];
+}
+
+
+//puts a message in the publication slot of the calling thread
+void actor::publish(message *msg) {
+    publication_slot &slot = m_publication_slots[producer_index() % m_publication_count];
+    void *head;
+    do {
+        head = atomic_load(&slot.m_head);
+        msg->m_next = static_cast<message *>(head);
+    } while (!atomic_compare_exchange(&slot.m_head, head, msg));
+
+    //the actor is terminated: fail the published messages, unless the thread
+    //which terminated it has gathered them already
+    if (atomic_load(&m_closed)) {
+        message_list messages;
+        gather(messages);
+        clear(messages);
+        return;
+    }
+
+    //the actor thread gathers all the slots at once,
+    //so it is only posted by the first message since it was last woken up
+    if (atomic_load(&m_signalled) || atomic_exchange(&m_signalled, 1)) return;
+    pthread_mutex_lock(&m_mutex);
+    bool hibernated = m_state == HIBERNATED;
+    if (hibernated) m_state = RUNNING;
+    pthread_mutex_unlock(&m_mutex);
+    if (hibernated) start(true);
+    sem_post(&m_sem);
+}
+
+
+//moves the messages of the publication slots to the end of the given list
+void actor::gather(message_list &messages) {
+    for (unsigned long i = 0; i < m_publication_count; ++i) {
+        publication_slot &slot = m_publication_slots[i];
+        if (!atomic_load(&slot.m_head)) continue;
+
+        //the stack is reversed, for the order the messages were put
+        message_list slot_messages;
+        message *msg = static_cast<message *>(atomic_exchange(&slot.m_head, 0));
+        while (msg) {
+            message *next = msg->m_next;
+            slot_messages.push_front(msg);
+            msg = next;
+        }
+        messages.splice_back(slot_messages);
+    }
+}
+
+
+//moves the messages of the publication slots to their queues
+void actor::gather_sub_queues() {
+    for (unsigned long i = 0; i < m_publication_count; ++i) {
+        publication_slot &slot = m_publication_slots[i];
+        if (!atomic_load(&slot.m_head)) continue;
+
+        //the stack is reversed, for the order the messages were put
+        message_list slot_messages;
+        message *msg = static_cast<message *>(atomic_exchange(&slot.m_head, 0));
+        while (msg) {
+            message *next = msg->m_next;
+            slot_messages.push_front(msg);
+            msg = next;
+        }
+
+        //a queue which becomes non-empty takes its turn after the others
+        if (m_sub_queues[i].empty()) {
+            m_active[(m_active_head + m_active_size) % m_publication_count] = i;
+            ++m_active_size;
+        }
+        m_sub_queues[i].splice_back(slot_messages);
+    }
+}
+
+
+//moves the messages of the next queue's turn to the pending messages
+bool actor::next_turn() {
+    if (!m_sub_queues) return false;
+
+    //the slots are gathered once per round, after each queue had its turn
+    if (!m_turns) {
+        gather_sub_queues();
+        m_turns = m_active_size;
+        if (!m_turns) return false;
+    }
+    --m_turns;
+
+    unsigned long i = m_active[m_active_head];
+    m_active_head = (m_active_head + 1) % m_publication_count;
+    --m_active_size;
+    message_list &queue = m_sub_queues[i];
+    for (unsigned long n = 0; n < m_quantum && !queue.empty(); ++n) {
+        m_pending.push_back(queue.pop_front());
+    }
+
+    //a queue with messages left waits for its next turn
+    if (!queue.empty()) {
+        m_active[(m_active_head + m_active_size) % m_publication_count] = i;
+        ++m_active_size;
+    }
+    return true;
+}
+
+
+//moves the messages of all the queues to the end of the given list
+void actor::flush_sub_queues(message_list &messages) {
+    if (!m_sub_queues) return;
+    for (; m_active_size; --m_active_size) {
+        messages.splice_back(m_sub_queues[m_active[m_active_head]]);
+        m_active_head = (m_active_head + 1) % m_publication_count;
+    }
+    m_turns = 0;
+}
+
+
+//checks if a message is published
+bool actor::published() const {
+    for (unsigned long i = 0; i < m_publication_count; ++i) {
+        if (atomic_load(&m_publication_slots[i].m_head)) return true;
+    }
+    return false;
+}
+
+
+//a timer task which puts a message delayed by the throttle;
+//it resolves the actor through a handle, in case it is destroyed meanwhile
+class actor::delayed_put : public timer::task {
+public:
+    //constructor
+    delayed_put(actor *a, message *msg) : m_actor(a), m_message(msg) {}
+
+    //fails the message, if the task is deleted without being executed
+    ~delayed_put() {
+        if (!m_message) return;
+        m_message->fail("actor terminated");
+        m_message->release();
+    }
+
+    //puts the message
+    virtual void run() {
+        handle<actor>::pin p = m_actor.lock();
+        if (!p) return;
+        p->put(m_message, PUT_DELAYED);
+        m_message = 0;
+    }
+
+private:
+    handle<actor> m_actor;
+    message *m_message;
+};
+
+
+//applies the throttle to a message; returns false if the message is
+//rejected or delayed, and so it must not be put now
+bool actor::apply_throttle(message *msg) {
+    if (m_throttle_mode == THROTTLE_REJECT) {
+        if (m_throttle->try_acquire()) return true;
+        atomic_increment(&m_throttled);
+        msg->fail("rate limited");
+        msg->release();
+        return false;
+    }
+
+    unsigned long long delay = m_throttle->reserve();
+    if (!delay) return true;
+
+    if (m_throttle_mode == THROTTLE_BLOCK || !m_throttle_timer) {
+        timespec ts;
+        ts.tv_sec = (time_t)(delay / 1000000000ULL);
+        ts.tv_nsec = (long)(delay % 1000000000ULL);
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+        return true;
+    }
+
+    m_throttle_timer->schedule_at(new delayed_put(this, msg), now_ns() + delay);
+    return false;
+}
+
+
+//sets the supervisor
+void actor::_set_supervisor(supervisor *const &s) {
+    m_supervisor = s;
+}
+
+
+//restarts the actor
+void actor::_restart() {
+    restart();
+}
+
+
+//terminates the actor, as if it failed
+void actor::_terminate() {
+    m_loop = false;
+    m_terminated = true;
+}
+
+
+//handles a message which threw: fails its result, and lets the supervisor decide
+void actor::failure(message *msg, const std::string &what) {
+    m_stash_current = false;
+    msg->fail(what);
+    msg->release();
+    m_scratch.reset();
+
+    //without a supervisor, the actor goes on with the next message
+    if (!m_supervisor) return;
+
+    //wait for the decision; if the supervisor is terminated or fails, stop
+    supervisor::directive d;
+    try {
+        d = m_supervisor->child_failed(this, what).get();
+    }
+    catch (const actor_error &) {
+        d = supervisor::STOP;
+    }
+
+    switch (d) {
+        case supervisor::RESUME:
+            break;
+
+        case supervisor::RESTART:
+            try {
+                restart();
+            }
+            catch (...) {
+                _terminate();
+            }
+            break;
+
+        default:
+            _terminate();
+            break;
+    }
+}
+
+
+//puts a restart message before the queued messages, for the supervisor
+void actor::restart_child() {
+    put_control(&actor::_restart, PUT_FRONT);
+}
+
+
+//puts a terminate message before the queued messages, for the supervisor
+void actor::terminate_child() {
+    pthread_mutex_lock(&m_mutex);
+    bool running = m_state == RUNNING || m_state == HIBERNATING || m_state == HIBERNATED;
+    pthread_mutex_unlock(&m_mutex);
+    if (running) put_control(&actor::_terminate, PUT_FRONT);
+}
+
+
+//enables hibernation
+void actor::_enable_hibernation(const unsigned long &idle_ms) {
+    m_idle_timeout = (unsigned long long)idle_ms * 1000000ULL;
+}
+
+
+//the message handling loop
+void actor::run() {
+    scratch_arena::set_current(&m_scratch);
+    m_loop = true;
+    m_terminated = false;
+
+    //restore the state, if the thread was started by a put to a hibernated actor
+    if (m_rehydrate) {
+        m_rehydrate = false;
+        atomic_add(&hibernated_actors, -1);
+        atomic_add(&hibernated_bytes, -(long)m_blob.size());
+        rehydrate(m_blob);
+        std::string().swap(m_blob);
+    }
+
+    //while the loop is active
+    while (m_loop) {
+        //wait for messages; if none arrives, try to hibernate
+        if (!wait()) {
+            if (try_hibernate()) return;
+            continue;
+        }
+        
+        //get all the messages (synchronized block);
+        //there may be none, if they were failed when the actor was terminated
+        pthread_mutex_lock(&m_mutex);
+        m_pending.splice_back(m_messages);
+        pthread_mutex_unlock(&m_mutex);
+
+        //gather the published messages; the signal is cleared first,
+        //so as that a message published after the gathering posts again;
+        //with fair queuing, they are gathered to their queues when a round starts
+        if (m_publication_slots) {
+            atomic_store(&m_signalled, 0);
+            if (m_sub_queues) m_turns = 0; else gather(m_pending);
+        }
+        
+        //execute the messages; with fair queuing, a turn at a time
+        while (m_loop && (!m_pending.empty() || next_turn())) {
+            message_ptr msg = m_pending.pop_front();
+
+            //drop an expired message; else measure its wait
+            if (msg->m_time) {
+                unsigned long long now = now_ns();
+                if (msg->m_deadline && now > msg->m_deadline) {
+                    atomic_increment(&m_expired);
+                    msg->fail("message expired");
+                    msg->release();
+                    continue;
+                }
+                atomic_store(&m_wait, (long)((now - msg->m_time) / 1000));
+            }
+
+            //merge the following messages for the same batch function
+            if (atomic_load(&m_batching) && msg->m_batch_tag) {
+                while (!m_pending.empty() && m_pending.front()->m_batch_tag == msg->m_batch_tag && msg->merge(m_pending.front())) {
+                    m_pending.pop_front()->release();
+                }
+            }
+
+            try {
+                msg->exec();
+            }
+            catch (const std::exception &ex) {
+                failure(msg, ex.what());
+                continue;
+            }
+            catch (...) {
+                failure(msg, "unknown exception");
+                continue;
+            }
+            if (m_stash_current) {
+                m_stash_current = false;
+                m_stash.push_back(msg);
+            }
+            else {
+                msg->release();
+            }
+            m_scratch.reset();
+        }
+
+        //the queue is drained, so new messages do not wait for old ones
+        if (m_wait) atomic_store(&m_wait, 0);
+    }
+
+    //a terminated actor fails its messages, until the supervisor restarts it
+    if (m_terminated) {
+        pthread_mutex_lock(&m_mutex);
+        if (m_state == RUNNING) {
+            m_state = FAILED;
+            if (m_publication_slots) atomic_store(&m_closed, 1);
+        }
+        m_pending.splice_back(m_messages);
+        pthread_mutex_unlock(&m_mutex);
+        if (m_publication_slots) {
+            flush_sub_queues(m_pending);
+            gather(m_pending);
+        }
+        clear(m_stash);
+        clear(m_pending);
+    }
+}
+
+
+//waits for messages; returns false if the idle time elapsed
+bool actor::wait() {
+    if (!m_idle_timeout) {
+        sem_wait(&m_sem);
+        return true;
+    }
+    //a semaphore waits until a time of day, so the deadline is taken from that clock
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    unsigned long long d = (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec + m_idle_timeout;
+    ts.tv_sec = (time_t)(d / 1000000000ULL);
+    ts.tv_nsec = (long)(d % 1000000000ULL);
+    while (sem_timedwait(&m_sem, &ts) != 0) {
+        if (errno == ETIMEDOUT) return false;
+    }
+    return true;
+}
+
+
+//hibernates the actor if no message arrived; returns true if hibernated
+bool actor::try_hibernate() {
+    pthread_mutex_lock(&m_mutex);
+    bool idle = m_messages.empty() && !published() && m_state == RUNNING;
+    if (idle) m_state = HIBERNATING;
+    pthread_mutex_unlock(&m_mutex);
+
+    //a message arrived, or the actor is stopping
+    if (!idle) return false;
+
+    //serialize the state and release the memory of the thread
+    hibernate(m_blob);
+    m_scratch.release();
+
+    //if a message arrived meanwhile, go on running
+    pthread_mutex_lock(&m_mutex);
+    bool woken = !m_messages.empty() || published();
+    if (!woken) {
+        m_state = HIBERNATED;
+        atomic_add(&hibernated_actors, 1);
+        atomic_add(&hibernated_bytes, (long)m_blob.size());
+    }
+    else if (m_state == HIBERNATING) {
+        m_state = RUNNING;
+    }
+    pthread_mutex_unlock(&m_mutex);
+    if (woken) {
+        rehydrate(m_blob);
+        std::string().swap(m_blob);
+    }
+    return !woken;
+}
+
+
+//starts a new thread for a hibernated or terminated actor
+void actor::start(bool rehydrate) {
+    pthread_mutex_lock(&m_thread_mutex);
+    pthread_join(m_thread, NULL);
+    m_rehydrate = rehydrate;
+    pthread_create(&m_thread, NULL, thread_proc, this);
+    pthread_mutex_unlock(&m_thread_mutex);
+}
+
+
+//fails and releases the messages of the given list
+void actor::clear(message_list &messages) {
+    while (!messages.empty()) {
+        message_ptr msg = messages.pop_front();
+        msg->fail("actor terminated");
+        msg->release();
+    }
+}
+
+
+//internal function which calls the thread's run function
+void *actor::thread_proc(void *arg) {
+    reinterpret_cast<actor *>(arg)->run();
+    return 0;
+}
+
+
+//takes a slot in the handle table
+void actor::acquire_slot() {
+    if (!pop_free_slot(m_slot)) m_slot = new_slot();
+    actor_slot &slot = get_slot(m_slot);
+    slot.m_actor = this;
+    m_generation = atomic_increment(&slot.m_generation);
+}
+
+
+//invalidates the handles, and waits until no handle pins the actor
+void actor::invalidate_slot() {
+    actor_slot &slot = get_slot(m_slot);
+    atomic_increment(&slot.m_generation);
+    while (atomic_load(&slot.m_pins)) sched_yield();
+}
+
+
+//frees the slot, after the handles are invalidated
+void actor::release_slot() {
+    actor_slot &slot = get_slot(m_slot);
+    slot.m_actor = 0;
+    push_free_slot(m_slot);
+}
+
+
+//pins the actor of the given slot, if it has the given generation;
+//returns null if the actor is destroyed
+actor *actor::pin(unsigned long index, long generation) {
+    if (!(generation & 1)) return 0;
+    actor_slot &slot = get_slot(index);
+
+    //a stale handle does not touch the pins, which a stopping actor waits
+    //for; the generation is checked again after the pin, against a stop between
+    if (atomic_load(&slot.m_generation) != generation) return 0;
+    atomic_increment(&slot.m_pins);
+    if (atomic_load(&slot.m_generation) == generation) return slot.m_actor;
+    atomic_decrement(&slot.m_pins);
+    return 0;
+}
+
+
+//pins again the actor of the given slot, which is pinned already
+void actor::repin(unsigned long index) {
+    atomic_increment(&get_slot(index).m_pins);
+}
+
+
+//unpins the actor of the given slot
+void actor::unpin(unsigned long index) {
+    atomic_decrement(&get_slot(index).m_pins);
+}
+
+
+/** the constructor.
+    @param rate calls per second.
+    @param burst number of calls allowed at once, after an idle period.
+ */
+throttle::throttle(double rate, double burst) :
+    m_interval((long long)(1e9 / rate)),
+    m_tolerance((long long)(1e9 / rate * (burst > 1 ? burst - 1 : 0))),
+    m_tat(0),
+    m_batch(burst >= 512 ? 64 : burst >= 16 ? (long long)(burst / 8) : 1),
+    m_credits(0)
+{
+}
+
+
+//takes a token, if one is available now
+bool throttle::try_acquire() {
+    if (take_credit()) return true;
+    for (;;) {
+        long long tat = atomic_load(&m_tat);
+        long long now = (long long)now_ns();
+        if (now < tat - m_tolerance) return false;
+        long long extra;
+        long long next = advance(tat, now, extra);
+        if (atomic_compare_exchange(&m_tat, tat, next)) {
+            if (extra) atomic_add(&m_credits, (long)extra);
+            return true;
+        }
+    }
+}
+
+
+//reserves a token, which may be available later
+unsigned long long throttle::reserve() {
+    if (take_credit()) return 0;
+    for (;;) {
+        long long tat = atomic_load(&m_tat);
+        long long now = (long long)now_ns();
+        long long extra;
+        long long next = advance(tat, now, extra);
+        if (atomic_compare_exchange(&m_tat, tat, next)) {
+            if (extra) atomic_add(&m_credits, (long)extra);
+            return now < tat - m_tolerance ? (unsigned long long)(tat - m_tolerance - now) : 0;
+        }
+    }
+}
+
+
+//takes a credit, if there is one
+bool throttle::take_credit() {
+    if (atomic_load(&m_credits) <= 0) return false;
+
+    //a decrement which finds no credit is undone; a refill in between is not lost
+    if (atomic_decrement(&m_credits) >= 0) return true;
+    atomic_increment(&m_credits);
+    return false;
+}
+
+
+//returns the theoretical arrival time after a call, and charges the extra calls of the batch
+long long throttle::advance(long long tat, long long now, long long &extra) const {
+    long long start = tat > now ? tat : now;
+
+    //the k-th extra call is allowed now if start + k * interval - tolerance <= now
+    if (now < tat - m_tolerance) extra = 0;
+    else extra = m_interval ? (now + m_tolerance - start) / m_interval : m_batch - 1;
+    if (extra > m_batch - 1) extra = m_batch - 1;
+    return start + (extra + 1) * m_interval;
+}
+
+
+/** the constructor.
+    @param s restart strategy.
+    @param max_restarts maximum number of restarts within the period;
+        one more restart escalates the failure.
+    @param period_ms the period, in milliseconds.
+    @param mr memory resource, as for actor.
+ */
+supervisor::supervisor(strategy s, size_t max_restarts, unsigned long period_ms, memory_resource *mr) :
+    actor(mr),
+    m_strategy(s),
+    m_max_restarts(max_restarts),
+    m_period((unsigned long long)period_ms * 1000000ULL),
+    m_restart_count(0)
+{
+}
+
+
+/** the destructor.
+    The supervisor is stopped, then the children are deleted,
+    in the reverse order they were added.
+ */
+supervisor::~supervisor() {
+    //children waiting for a decision get an error, and terminate
+    stop();
+    while (!m_children.empty()) {
+        delete m_children.back();
+        m_children.pop_back();
+    }
+}
+
+
+/** adds a child.
+    The supervisor takes ownership of the child.
+    @param child child to add.
+ */
+void supervisor::add(actor *child) {
+    //the child is added before it can report a failure
+    put(&supervisor::_add, child);
+    child->put_control(&actor::_set_supervisor, static_cast<supervisor *>(this));
+}
+
+
+//restarts all the children
+void supervisor::restart() {
+    m_restarts.clear();
+    for (size_t i = 0; i < m_children.size(); ++i) {
+        m_children[i]->restart_child();
+    }
+}
+
+
+//adds a child
+void supervisor::_add(actor *const &child) {
+    m_children.push_back(child);
+}
+
+
+//returns the number of restarts
+size_t supervisor::_restart_count() {
+    return m_restart_count;
+}
+
+
+//decides about a failed child, and applies the decision to the other children
+supervisor::directive supervisor::_child_failed(actor *const &child, const std::string &what) {
+    directive d = decide(child, what);
+
+    //too many restarts within the period escalate the failure
+    if (d == RESTART) {
+        unsigned long long now = now_ns();
+        m_restarts.push_back(now);
+        while (now - m_restarts.front() > m_period) m_restarts.pop_front();
+        if (m_restarts.size() > m_max_restarts) d = ESCALATE;
+    }
+
+    switch (d) {
+        case RESTART: {
+            //the failed child restarts itself, on the returned decision
+            ++m_restart_count;
+            bool after = false;
+            for (size_t i = 0; i < m_children.size(); ++i) {
+                if (m_children[i] == child) {
+                    after = true;
+                }
+                else if (m_strategy == ONE_FOR_ALL || (m_strategy == REST_FOR_ONE && after)) {
+                    m_children[i]->restart_child();
+                }
+            }
+            break;
+        }
+
+        case ESCALATE:
+            //the failed child gets the error as the decision, and terminates
+            for (size_t i = 0; i < m_children.size(); ++i) {
+                if (m_children[i] != child) m_children[i]->terminate_child();
+            }
+            throw actor_error("supervisor failed: " + what);
+
+        default:
+            break;
+    }
+
+    return d;
+}
+
+
+//the resource of the global heap
+class new_delete_memory_resource : public memory_resource {
+protected:
+    //allocates memory
+    virtual void *do_allocate(size_t bytes) {
+        return ::operator new(bytes);
+    }
+
+    //releases memory
+    virtual void do_deallocate(void *p, size_t) {
+        ::operator delete(p);
+    }
+};
+
+
+//returns the resource which uses the global operator new and delete
+memory_resource *new_delete_resource() {
+    static new_delete_memory_resource resource;
+    return &resource;
+}
+
+
+//size of the size classes of the pool
+static const size_t POOL_GRANULARITY = 16;
+
+
+/** the constructor.
+    @param upstream resource to take chunks from; if null, the global heap.
+    @param chunk_size size of chunks.
+    @param max_block maximum size of blocks kept in the pool.
+ */
+pool_resource::pool_resource(memory_resource *upstream, size_t chunk_size, size_t max_block) :
+    m_upstream(upstream ? upstream : new_delete_resource()),
+    m_chunk_size(chunk_size),
+    m_max_block(max_block < chunk_size ? max_block : chunk_size),
+    m_free((m_max_block + POOL_GRANULARITY - 1) / POOL_GRANULARITY, 0),
+    m_chunk_ptr(0),
+    m_chunk_left(0)
+{
+    pthread_mutex_init(&m_mutex, NULL);
+}
+
+
+/** the destructor.
+    All the memory allocated from the pool is released.
+ */
+pool_resource::~pool_resource() {
+    for (size_t i = 0; i < m_chunks.size(); ++i) {
+        m_upstream->deallocate(m_chunks[i], m_chunk_size);
+    }
+    pthread_mutex_destroy(&m_mutex);
+}
+
+
+//allocates memory
+void *pool_resource::do_allocate(size_t bytes) {
+    if (bytes > m_max_block) return m_upstream->allocate(bytes);
+    size_t index = bytes ? (bytes - 1) / POOL_GRANULARITY : 0;
+    size_t size = (index + 1) * POOL_GRANULARITY;
+    void *p;
+    pthread_mutex_lock(&m_mutex);
+    if (m_free[index]) {
+        p = m_free[index];
+        m_free[index] = m_free[index]->m_next;
+    }
+    else {
+        if (m_chunk_left < size) {
+            void *chunk;
+            try {
+                chunk = m_upstream->allocate(m_chunk_size);
+                m_chunks.push_back(chunk);
+            }
+            catch (...) {
+                pthread_mutex_unlock(&m_mutex);
+                throw;
+            }
+            m_chunk_ptr = static_cast<char *>(chunk);
+            m_chunk_left = m_chunk_size;
+        }
+        p = m_chunk_ptr;
+        m_chunk_ptr += size;
+        m_chunk_left -= size;
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return p;
+}
+
+
+//releases memory
+void pool_resource::do_deallocate(void *p, size_t bytes) {
+    if (bytes > m_max_block) {
+        m_upstream->deallocate(p, bytes);
+        return;
+    }
+    size_t index = bytes ? (bytes - 1) / POOL_GRANULARITY : 0;
+    free_block *b = static_cast<free_block *>(p);
+    pthread_mutex_lock(&m_mutex);
+    b->m_next = m_free[index];
+    m_free[index] = b;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+
+//key of the parker of the calling thread
+static pthread_key_t parker_key;
+static pthread_once_t parker_key_once = PTHREAD_ONCE_INIT;
+
+
+//creates the key of the parkers
+void actor::parker::create_key() {
+    pthread_key_create(&parker_key, destroy);
+}
+
+
+//constructor
+actor::parker::parker() {
+    sem_init(&m_sem, 0, 0);
+}
+
+
+//destructor
+actor::parker::~parker() {
+    sem_destroy(&m_sem);
+}
+
+
+//returns the parker of the calling thread, creating it on first use
+actor::parker &actor::parker::current() {
+    pthread_once(&parker_key_once, create_key);
+    parker *p = static_cast<parker *>(pthread_getspecific(parker_key));
+    if (!p) {
+        p = new parker;
+        pthread_setspecific(parker_key, p);
+    }
+    return *p;
+}
+
+
+//waits until the thread is unparked
+void actor::parker::park() {
+    while (sem_wait(&m_sem) != 0 && errno == EINTR) {}
+}
+
+
+//unparks the waiting thread
+void actor::parker::unpark() {
+    sem_post(&m_sem);
+}
+
+
+//deletes the parker of a terminating thread
+void actor::parker::destroy(void *p) {
+    delete static_cast<parker *>(p);
+}
+
+
+//key of the scratch arena of the calling thread
+static pthread_key_t scratch_key;
+static pthread_once_t scratch_key_once = PTHREAD_ONCE_INIT;
+
+
+//creates the key of the scratch arena
+static void create_scratch_key() {
+    pthread_key_create(&scratch_key, NULL);
+}
+
+
+/** the constructor.
+    No memory is allocated until the first allocation.
+    @param upstream resource to take blocks from; if null, the global heap.
+    @param block_size minimum size of blocks.
+ */
+scratch_arena::scratch_arena(memory_resource *upstream, size_t block_size) :
+    m_upstream(upstream ? upstream : new_delete_resource()),
+    m_block_size(block_size),
+    m_first(0),
+    m_block(0),
+    m_ptr(0),
+    m_end(0)
+{
+}
+
+
+/** the destructor.
+ */
+scratch_arena::~scratch_arena() {
+    release();
+}
+
+
+//releases the blocks of the arena
+void scratch_arena::release() {
+    while (m_first) {
+        block *b = m_first;
+        m_first = b->m_next;
+        m_upstream->deallocate(b, ALIGNMENT + b->m_size);
+    }
+    reset();
+}
+
+
+//returns the arena of the actor which runs in the calling thread
+scratch_arena *scratch_arena::current() {
+    pthread_once(&scratch_key_once, create_scratch_key);
+    return static_cast<scratch_arena *>(pthread_getspecific(scratch_key));
+}
+
+
+//sets the arena of the calling thread
+void scratch_arena::set_current(scratch_arena *arena) {
+    pthread_once(&scratch_key_once, create_scratch_key);
+    pthread_setspecific(scratch_key, arena);
+}
+
+
+//moves to the next block which fits the allocation, creating it if needed
+void *scratch_arena::allocate_block(size_t bytes) {
+    block *next = m_block ? m_block->m_next : m_first;
+    if (!next || next->m_size < bytes) {
+        size_t size = bytes > m_block_size ? bytes : m_block_size;
+        block *b = static_cast<block *>(m_upstream->allocate(ALIGNMENT + size));
+        b->m_size = size;
+        b->m_next = next;
+        if (m_block) m_block->m_next = b; else m_first = b;
+        next = b;
+    }
+    m_block = next;
+    m_ptr = next->begin() + bytes;
+    m_end = next->end();
+    return next->begin();
+}
+
+
+//returns the current time of a monotonic clock, in nanoseconds
+unsigned long long now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+//initializes a condition variable for timed waits on the clock of now_ns()
+void monotonic_cond_init(pthread_cond_t *c) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(c, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+
+/** constructs a timer.
+    The internal thread is started.
+ */
+timer::timer() {
+    m_loop = true;
+    m_next_id = 1;
+    m_running = 0;
+    pthread_mutex_init(&m_mutex, NULL);
+    monotonic_cond_init(&m_cond);
+    pthread_create(&m_thread, NULL, thread_proc, this);
+}
+
+
+/** destroys the timer.
+    Tasks not yet executed are deleted without being executed.
+ */
+timer::~timer() {
+    pthread_mutex_lock(&m_mutex);
+    m_loop = false;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+    pthread_join(m_thread, NULL);
+    for (task_queue::iterator it = m_tasks.begin(); it != m_tasks.end(); ++it) {
+        delete it->second.second;
+    }
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+
+//schedules a task
+timer::id timer::schedule(task *t, unsigned long ms) {
+    return schedule_at(t, now_ns() + (deadline)ms * 1000000ULL);
+}
+
+
+//schedules a task at the given time
+timer::id timer::schedule_at(task *t, unsigned long long d) {
+    pthread_mutex_lock(&m_mutex);
+    id i = m_next_id++;
+    task_queue::iterator it = m_tasks.insert(std::make_pair(d, std::make_pair(i, t)));
+    m_index[i] = it;
+    //wake up the timer thread only if the new task is the earliest one
+    if (it == m_tasks.begin()) pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+    return i;
+}
+
+
+//cancels a task
+bool timer::cancel(id i) {
+    task *t = 0;
+    pthread_mutex_lock(&m_mutex);
+    task_index::iterator it = m_index.find(i);
+    if (it != m_index.end()) {
+        t = it->second->second.second;
+        m_tasks.erase(it->second);
+        m_index.erase(it);
+    }
+    else {
+        while (m_running == i) pthread_cond_wait(&m_cond, &m_mutex);
+    }
+    pthread_mutex_unlock(&m_mutex);
+    delete t;
+    return t != 0;
+}
+
+
+//the timer loop
+void timer::run() {
+    pthread_mutex_lock(&m_mutex);
+    while (m_loop) {
+        //wait for a task
+        if (m_tasks.empty()) {
+            pthread_cond_wait(&m_cond, &m_mutex);
+            continue;
+        }
+
+        //wait for the earliest task to become due
+        task_queue::iterator it = m_tasks.begin();
+        deadline d = it->first;
+        if (d > now_ns()) {
+            timespec ts;
+            ts.tv_sec = (time_t)(d / 1000000000ULL);
+            ts.tv_nsec = (long)(d % 1000000000ULL);
+            pthread_cond_timedwait(&m_cond, &m_mutex, &ts);
+            continue;
+        }
+
+        //execute the task outside of the lock
+        task *t = it->second.second;
+        m_running = it->second.first;
+        m_index.erase(m_running);
+        m_tasks.erase(it);
+        pthread_mutex_unlock(&m_mutex);
+        t->run();
+        delete t;
+        pthread_mutex_lock(&m_mutex);
+        m_running = 0;
+        pthread_cond_broadcast(&m_cond);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+
+//internal function which calls the thread's run function
+void *timer::thread_proc(void *arg) {
+    reinterpret_cast<timer *>(arg)->run();
+    return 0;
+}
+
+
+} //namespace actorlib
@@ -1,739 +1,3260 @@
-#ifndef ACTORLIB_HPP
-#define ACTORLIB_HPP
-
-
-#include <pthread.h>
-#include <semaphore.h>
-#include <list>
-
-
-namespace actorlib {
-
-
-/** result of an actor's computation.
-    Value-type class.
-    Not thread-safe; different values are thread-safe.
-    @param R type of result.
- */
-template <class R> class result {
-public:
-    /** the default constructor.
-        @param v the default value of the result.
-     */
-    result(const R &v = R()) : m_data(new data(v)) {}
-
-    /** the copy constructor.
-        @param r source object.
-     */
-    result(const result<R> &r) : m_data(r.m_data) {
-        m_data->inc_ref();
-    }
-
-    /** the destructor.
-     */
-    ~result() {
-        m_data->dec_ref();
-    }
-
-    /** the assignment operator.
-        @param r source object.
-        @return reference to this.
-     */
-    result<R> &operator = (const result<R> &r) {
-        r.m_data->inc_ref();
-        m_data->dec_ref();
-        m_data = r.m_data;
-        return *this;
-    }
-
-    /** retrieves the value of the computation.
-        It blocks until the result is available.
-        @return the value of the computation.
-     */
-    R get() const {
-        return m_data->get();
-    }
-
-    /** automatic conversion to value.
-        It calls the get() function.
-        @return the value of the computation.
-     */
-    operator R () const {
-        return m_data->get();
-    }
-
-    /** sets the value.
-        Any thread waiting on the result value will be awoken.
-        @param v new value.
-     */
-    void set(const R &v) {
-        m_data->set(v);
-    }
-
-    /** assignment from value.
-        It calls the set(v) function.
-        @param v new value.
-        @return reference to this.
-     */
-    result<R> &operator = (const R &v) {
-        m_data->set(v);
-        return *this;
-    }
-
-private:
-    //the internal result structure, shared by all threads
-    struct data {
-        //mutex
-        pthread_mutex_t m_mutex;
-
-        //wait condition
-        pthread_cond_t m_cond;
-
-        //reference count
-        size_t m_ref_count;
-
-        //result value
-        R m_value;
-
-        //if value is set
-        bool m_value_set;
-
-        //constructor
-        data(const R &v) : m_value(v) {
-            pthread_mutex_init(&m_mutex, NULL);
-            pthread_cond_init(&m_cond, NULL);
-            m_ref_count = 1;
-            m_value_set = false;
-        }
-
-        //destructor
-        ~data() {
-            pthread_cond_destroy(&m_cond);
-            pthread_mutex_destroy(&m_mutex);
-        }
-
-        //increment the reference count
-        void inc_ref() {
-            pthread_mutex_lock(&m_mutex);
-            ++m_ref_count;
-            pthread_mutex_unlock(&m_mutex);
-        }
-
-        //decrements the reference count and deletes the object if it reaches 0
-        void dec_ref() {
-            pthread_mutex_lock(&m_mutex);
-            bool delete_this = --m_ref_count == 0;
-            pthread_mutex_unlock(&m_mutex);
-            if (delete_this) delete this;
-        }
-
-        //get the value
-        R get() {
-            pthread_mutex_lock(&m_mutex);
-            if (!m_value_set) pthread_cond_wait(&m_cond, &m_mutex);
-            R r = m_value;
-            pthread_mutex_unlock(&m_mutex);
-            return r;
-        }
-
-        //set the value
-        void set(const R &v) {
-            pthread_mutex_lock(&m_mutex);
-            m_value = v;
-            m_value_set = true;
-            pthread_mutex_unlock(&m_mutex);
-            pthread_cond_signal(&m_cond);
-        }
-    };
-
-    //internal pointer to data
-    data *m_data;
-};
-
-
-/** specialization for void result.
- */
-template <> class result<void> {
-public:
-};
-
-
-/** the base class for all actors.
-
-    It provides the interface for posting messages to actors.
-
-    The messages are entered in queue, and then the actor's thread
-    is woken up to process the messages.
-
-    The messages are calls to the internal functions of the object.
- */
-class actor {
-public:
-    /** constructs an actor.
-        The internal thread is started.
-     */
-    actor();
-
-    /** destroys an actor.
-        The calling thread blocks until the actor thread is terminated.
-     */
-    ~actor();
-
-protected:
-    /** puts a message with 0 parameters.
-        @param f function to put.
-     */
-    template <class C, class R> result<R> put(R (C::*f)()) {
-        result<R> r;
-        put(new object_message_0<C, R>(static_cast<C *>(this), r, f));
-        return r;
-    }
-
-    /** puts a message with 1 parameter.
-        @param f function to put.
-        @param t1 1st argument.
-     */
-    template <class C, class R, class T1> result<R> put(R (C::*f)(const T1 &), const T1 &t1) {
-        result<R> r;
-        put(new object_message_1<C, R, T1>(static_cast<C *>(this), r, f, t1));
-        return r;
-    }
-
-    /** puts a message with 2 parameters.
-        @param f function to put.
-        @param t1 1st argument.
-        @param t2 2nd argument.
-     */
-    template <class C, class R, class T1, class T2> result<R> put(R (C::*f)(const T1 &, const T2 &), const T1 &t1, const T2 &t2) {
-        result<R> r;
-        put(new object_message_2<C, R, T1, T2>(static_cast<C *>(this), r, f, t1, t2));
-        return r;
-    }
-
-    /** puts the exit message in the message loop.
-        If this message is executed, the loop is terminated.
-     */
-    void exit() {
-        put(&actor::_exit);
-    }
-
-private:
-    //invoke object with a non-void result
-    template <class C, class R> class invoker {
-    public:
-        //invoke with 0 params
-        static void exec(result<R> &r, C *o, R (C::*f)()) {
-            r = (o->*f)();
-        }
-
-        //invoke with 1 param
-        template <class T1> static void exec(result<R> &r, C *o, R (C::*f)(const T1 &), const T1 &t1) {
-            r = (o->*f)(t1);
-        }
-
-        //invoke with 2 params
-        template <class T1, class T2>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &),
-            const T1 &t1, const T2 &t2)
-        {
-            r = (o->*f)(t1, t2);
-        }
-
-        //invoke with 3 params
-        template <class T1, class T2, class T3>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &),
-            const T1 &t1, const T2 &t2, const T3 &t3)
-        {
-            r = (o->*f)(t1, t2, t3);
-        }
-
-        //invoke with 4 params
-        template <class T1, class T2, class T3, class T4>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4)
-        {
-            r = (o->*f)(t1, t2, t3, t4);
-        }
-
-        //invoke with 5 params
-        template <class T1, class T2, class T3, class T4, class T5>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5)
-        {
-            r = (o->*f)(t1, t2, t3, t4, t5);
-        }
-
-        //invoke with 6 params
-        template <class T1, class T2, class T3, class T4, class T5, class T6>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6)
-        {
-            r = (o->*f)(t1, t2, t3, t4, t5, t6);
-        }
-
-        //invoke with 7 params
-        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7)
-        {
-            r = (o->*f)(t1, t2, t3, t4, t5, t6, t7);
-        }
-
-        //invoke with 8 params
-        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8)
-        {
-            r = (o->*f)(t1, t2, t3, t4, t5, t6, t7, t8);
-        }
-
-        //invoke with 9 params
-        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8, class T9>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &, const T9 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8, const T9 &t9)
-        {
-            r = (o->*f)(t1, t2, t3, t4, t5, t6, t7, t8, t9);
-        }
-    };
-
-    //specialization for void
-    template <class C> class invoker<C, void> {
-    public:
-        //invoke with 0 params
-        static void exec(result<void> &r, C *o, void (C::*f)()) {
-            (o->*f)();
-        }
-
-        //invoke with 1 param
-        template <class T1> static void exec(result<void> &r, C *o, void (C::*f)(const T1 &), const T1 &t1) {
-            (o->*f)(t1);
-        }
-
-        //invoke with 2 params
-        template <class T1, class T2>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &),
-            const T1 &t1, const T2 &t2)
-        {
-            (o->*f)(t1, t2);
-        }
-
-        //invoke with 3 params
-        template <class T1, class T2, class T3>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &),
-            const T1 &t1, const T2 &t2, const T3 &t3)
-        {
-            (o->*f)(t1, t2, t3);
-        }
-
-        //invoke with 4 params
-        template <class T1, class T2, class T3, class T4>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4)
-        {
-            (o->*f)(t1, t2, t3, t4);
-        }
-
-        //invoke with 5 params
-        template <class T1, class T2, class T3, class T4, class T5>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5)
-        {
-            (o->*f)(t1, t2, t3, t4, t5);
-        }
-
-        //invoke with 6 params
-        template <class T1, class T2, class T3, class T4, class T5, class T6>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6)
-        {
-            (o->*f)(t1, t2, t3, t4, t5, t6);
-        }
-
-        //invoke with 7 params
-        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7)
-        {
-            (o->*f)(t1, t2, t3, t4, t5, t6, t7);
-        }
-
-        //invoke with 8 params
-        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8)
-        {
-            (o->*f)(t1, t2, t3, t4, t5, t6, t7, t8);
-        }
-
-        //invoke with 9 params
-        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8, class T9>
-        static void exec(result<void> &r, C *o,
-            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &, const T9 &),
-            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8, const T9 &t9)
-        {
-            (o->*f)(t1, t2, t3, t4, t5, t6, t7, t8, t9);
-        }
-    };
-
-    //a message
-    class message {
-    public:
-        //virtual destructor due to virtual implementation.
-        virtual ~message() {}
-
-        //interface for executing the message
-        virtual void exec() = 0;
-    };
-
-    //a message with a specific target object and result
-    template <class C, class R> class object_message : public message {
-    public:
-        //object
-        C *m_object;
-
-        //result variable
-        result<R> m_result;
-
-        //constructor.
-        object_message(C *object, const result<R> &r) :
-            m_object(object), m_result(r) {}
-    };
-
-    //a message with zero parameters
-    template <class C, class R> class object_message_0 : public object_message<C, R> {
-    public:
-        //function type
-        typedef R (C::*function)();
-
-        //function
-        function m_function;
-
-        //constructor.
-        object_message_0(C *object, const result<R> &r, function f) :
-            object_message<C, R>(object, r), m_function(f) {}
-
-        //calls the function
-        virtual void exec() {
-            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function);
-        }
-    };
-
-    //a message with 1 parameter
-    template <class C, class R, class T1>
-    class object_message_1 :
-        public object_message<C, R>
-    {
-    public:
-        //function type
-        typedef R (C::*function)(const T1 &);
-
-        //function
-        function m_function;
-
-        //argument 1
-        T1 m_t1;
-
-        //constructor.
-        object_message_1(C *object, const result<R> &r, function f, const T1 &t1) :
-            object_message<C, R>(object, r), m_function(f), m_t1(t1) {}
-
-        //calls the function
-        virtual void exec() {
-            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1);
-        }
-    };
-
-    //a message with 2 parameters
-    template <class C, class R, class T1, class T2>
-    class object_message_2 :
-        public object_message<C, R>
-    {
-    public:
-        //function type
-        typedef R (C::*function)(const T1 &, const T2 &);
-
-        //function
-        function m_function;
-
-        //arguments
-        T1 m_t1;
-        T2 m_t2;
-
-        //constructor.
-        object_message_2(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2) :
-            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2) {}
-
-        //calls the function
-        virtual void exec() {
-            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2);
-        }
-    };
-
-    //a message with 3 parameters
-    template <class C, class R, class T1, class T2, class T3>
-    class object_message_3 :
-        public object_message<C, R>
-    {
-    public:
-        //function type
-        typedef R (C::*function)(const T1 &, const T2 &, const T3 &);
-
-        //function
-        function m_function;
-
-        //arguments
-        T1 m_t1;
-        T2 m_t2;
-        T3 m_t3;
-
-        //constructor.
-        object_message_3(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3) :
-            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3) {}
-
-        //calls the function
-        virtual void exec() {
-            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3);
-        }
-    };
-
-    //a message with 4 parameters
-    template <class C, class R, class T1, class T2, class T3, class T4>
-    class object_message_4 :
-        public object_message<C, R>
-    {
-    public:
-        //function type
-        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &);
-
-        //function
-        function m_function;
-
-        //arguments
-        T1 m_t1;
-        T2 m_t2;
-        T3 m_t3;
-        T4 m_t4;
-
-        //constructor.
-        object_message_4(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4) :
-            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4) {}
-
-        //calls the function
-        virtual void exec() {
-            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4);
-        }
-    };
-
-    //a message with 5 parameters
-    template <class C, class R, class T1, class T2, class T3, class T4, class T5>
-    class object_message_5 :
-        public object_message<C, R>
-    {
-    public:
-        //function type
-        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &);
-
-        //function
-        function m_function;
-
-        //arguments
-        T1 m_t1;
-        T2 m_t2;
-        T3 m_t3;
-        T4 m_t4;
-        T5 m_t5;
-
-        //constructor.
-        object_message_5(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5) :
-            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4), m_t5(t5) {}
-
-        //calls the function
-        virtual void exec() {
-            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4, m_t5);
-        }
-    };
-
-    //a message with 6 parameters
-    template <class C, class R, class T1, class T2, class T3, class T4, class T5, class T6>
-    class object_message_6 :
-        public object_message<C, R>
-    {
-    public:
-        //function type
-        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &);
-
-        //function
-        function m_function;
-
-        //arguments
-        T1 m_t1;
-        T2 m_t2;
-        T3 m_t3;
-        T4 m_t4;
-        T5 m_t5;
-        T6 m_t6;
-
-        //constructor.
-        object_message_6(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6) :
-            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4), m_t5(t5), m_t6(t6) {}
-
-        //calls the function
-        virtual void exec() {
-            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4, m_t5, m_t6);
-        }
-    };
-
-    //a message with 7 parameters
-    template <class C, class R, class T1, class T2, class T3, class T4, class T5, class T6, class T7>
-    class object_message_7 :
-        public object_message<C, R>
-    {
-    public:
-        //function type
-        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &);
-
-        //function
-        function m_function;
-
-        //arguments
-        T1 m_t1;
-        T2 m_t2;
-        T3 m_t3;
-        T4 m_t4;
-        T5 m_t5;
-        T6 m_t6;
-        T7 m_t7;
-
-        //constructor.
-        object_message_7(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7) :
-            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4), m_t5(t5), m_t6(t6), m_t7(t7) {}
-
-        //calls the function
-        virtual void exec() {
-            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4, m_t5, m_t6, m_t7);
-        }
-    };
-
-    //a message with 8 parameters
-    template <class C, class R, class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8>
-    class object_message_8 :
-        public object_message<C, R>
-    {
-    public:
-        //function type
-        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &);
-
-        //function
-        function m_function;
-
-        //arguments
-        T1 m_t1;
-        T2 m_t2;
-        T3 m_t3;
-        T4 m_t4;
-        T5 m_t5;
-        T6 m_t6;
-        T7 m_t7;
-        T8 m_t8;
-
-        //constructor.
-        object_message_8(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8) :
-            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4), m_t5(t5), m_t6(t6), m_t7(t7), m_t8(t8) {}
-
-        //calls the function
-        virtual void exec() {
-            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4, m_t5, m_t6, m_t7, m_t8);
-        }
-    };
-
-    //a message with 9 parameters
-    template <class C, class R, class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8, class T9>
-    class object_message_9 :
-        public object_message<C, R>
-    {
-    public:
-        //function type
-        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &, const T9 &);
-
-        //function
-        function m_function;
-
-        //arguments
-        T1 m_t1;
-        T2 m_t2;
-        T3 m_t3;
-        T4 m_t4;
-        T5 m_t5;
-        T6 m_t6;
-        T7 m_t7;
-        T8 m_t8;
-        T9 m_t9;
-
-        //constructor.
-        object_message_9(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8, const T9 &t9) :
-            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4), m_t5(t5), m_t6(t6), m_t7(t7), m_t8(t8), m_t9(t9) {}
-
-        //calls the function
-        virtual void exec() {
-            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4, m_t5, m_t6, m_t7, m_t8, m_t9);
-        }
-    };
-
-    //type message ptr
-    typedef message *message_ptr;
-
-    //type of message list
-    typedef std::list<message_ptr> message_list;
-
-    //loop flag
-    bool m_loop;
-
-    //mutex used for synchronization over the message list
-    pthread_mutex_t m_mutex;
-
-    //semaphore used for counting the messages of the message list
-    sem_t m_sem;
-
-    //thread handle
-    pthread_t m_thread;
-
-    //messages
-    message_list m_messages;
-
-    //not copyable
-    actor(const actor &);
-    actor &operator = (const actor &);
-
-    //puts a message in the message queue, synchronized
-    void put(message *msg);
-
-    //exit
-    void _exit();
-
-    //the message handling loop
-    void run();
-
-    //internal function which calls the thread's run function
-    static void *thread_proc(void *arg);
-};
-
-
-} //namespace actorlib
-
-
-#endif //ACTORLIB_HPP
+#ifndef ACTORLIB_HPP
+#define ACTORLIB_HPP
+
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <cerrno>
+#include <ctime>
+#include <cstddef>
+#include <new>
+#include <map>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+/** size of a cache line, used for keeping data written by different
+    threads in different cache lines. Define it as 1 to disable the padding.
+    It changes the layout of the actor and of the result data, so the
+    library and every translation unit which includes this header must be
+    built with the same value; mixing values breaks the one definition rule.
+ */
+#ifndef ACTORLIB_CACHE_LINE_SIZE
+#define ACTORLIB_CACHE_LINE_SIZE 64
+#endif
+
+
+/** defined as 1 if the compiler has move semantics and variadic templates,
+    which results use for values which are expensive to copy, or not copyable.
+    Define it as 0 to disable them.
+ */
+#ifndef ACTORLIB_HAS_MOVE
+#if __cplusplus >= 201103L
+#define ACTORLIB_HAS_MOVE 1
+#else
+#define ACTORLIB_HAS_MOVE 0
+#endif
+#endif
+
+
+namespace actorlib {
+
+
+/** atomically increments a value.
+    @param v pointer to value.
+    @return the new value.
+ */
+inline long atomic_increment(volatile long *v) {
+#ifdef _MSC_VER
+    return _InterlockedIncrement(v);
+#else
+    return __sync_add_and_fetch(v, 1);
+#endif
+}
+
+
+/** atomically adds to a value.
+    @param v pointer to value.
+    @param n number to add.
+    @return the new value.
+ */
+inline long atomic_add(volatile long *v, long n) {
+#ifdef _MSC_VER
+    return _InterlockedExchangeAdd(v, n) + n;
+#else
+    return __sync_add_and_fetch(v, n);
+#endif
+}
+
+
+/** atomically decrements a value.
+    @param v pointer to value.
+    @return the new value.
+ */
+inline long atomic_decrement(volatile long *v) {
+#ifdef _MSC_VER
+    return _InterlockedDecrement(v);
+#else
+    return __sync_sub_and_fetch(v, 1);
+#endif
+}
+
+
+/** atomically reads a value.
+    @param v pointer to value.
+    @return the value.
+ */
+inline long atomic_load(const volatile long *v) {
+#if defined(_MSC_VER)
+    return *v;
+#elif defined(__ATOMIC_SEQ_CST)
+    return __atomic_load_n(v, __ATOMIC_SEQ_CST);
+#else
+    __sync_synchronize();
+    return *v;
+#endif
+}
+
+
+/** atomically writes a value.
+    @param v pointer to value.
+    @param n the new value.
+ */
+inline void atomic_store(volatile long *v, long n) {
+#if defined(_MSC_VER)
+    _InterlockedExchange(v, n);
+#elif defined(__ATOMIC_SEQ_CST)
+    __atomic_store_n(v, n, __ATOMIC_SEQ_CST);
+#else
+    __sync_synchronize();
+    *v = n;
+    __sync_synchronize();
+#endif
+}
+
+
+/** atomically reads a 64-bit value.
+    @param v pointer to value.
+    @return the value.
+ */
+inline long long atomic_load(const volatile long long *v) {
+#if defined(_MSC_VER)
+    return _InterlockedCompareExchange64(const_cast<volatile long long *>(v), 0, 0);
+#elif defined(__ATOMIC_SEQ_CST)
+    return __atomic_load_n(v, __ATOMIC_SEQ_CST);
+#else
+    return __sync_val_compare_and_swap(const_cast<volatile long long *>(v), 0, 0);
+#endif
+}
+
+
+/** atomically replaces a 64-bit value, if it has the expected value.
+    @param v pointer to value.
+    @param expected the expected value.
+    @param desired the new value.
+    @return true if the value was replaced.
+ */
+inline bool atomic_compare_exchange(volatile long long *v, long long expected, long long desired) {
+#ifdef _MSC_VER
+    return _InterlockedCompareExchange64(v, desired, expected) == expected;
+#else
+    return __sync_bool_compare_and_swap(v, expected, desired);
+#endif
+}
+
+
+/** atomically replaces a value.
+    @param v pointer to value.
+    @param n the new value.
+    @return the previous value.
+ */
+inline long atomic_exchange(volatile long *v, long n) {
+#if defined(_MSC_VER)
+    return _InterlockedExchange(v, n);
+#elif defined(__ATOMIC_SEQ_CST)
+    return __atomic_exchange_n(v, n, __ATOMIC_SEQ_CST);
+#else
+    __sync_synchronize();
+    return __sync_lock_test_and_set(v, n);
+#endif
+}
+
+
+/** atomically reads a pointer.
+    @param v pointer to the pointer.
+    @return the pointer.
+ */
+inline void *atomic_load(void *const volatile *v) {
+#if defined(_MSC_VER)
+    return *v;
+#elif defined(__ATOMIC_SEQ_CST)
+    return __atomic_load_n(v, __ATOMIC_SEQ_CST);
+#else
+    __sync_synchronize();
+    return *v;
+#endif
+}
+
+
+/** atomically replaces a pointer.
+    @param v pointer to the pointer.
+    @param p the new pointer.
+    @return the previous pointer.
+ */
+inline void *atomic_exchange(void *volatile *v, void *p) {
+#if defined(_MSC_VER)
+    return _InterlockedExchangePointer(v, p);
+#elif defined(__ATOMIC_SEQ_CST)
+    return __atomic_exchange_n(v, p, __ATOMIC_SEQ_CST);
+#else
+    __sync_synchronize();
+    return __sync_lock_test_and_set(v, p);
+#endif
+}
+
+
+/** atomically replaces a pointer, if it has the expected value.
+    @param v pointer to the pointer.
+    @param expected the expected pointer.
+    @param desired the new pointer.
+    @return true if the pointer was replaced.
+ */
+inline bool atomic_compare_exchange(void *volatile *v, void *expected, void *desired) {
+#ifdef _MSC_VER
+    return _InterlockedCompareExchangePointer(v, desired, expected) == expected;
+#else
+    return __sync_bool_compare_and_swap(v, expected, desired);
+#endif
+}
+
+
+/** the interface of a source of memory.
+
+    It mirrors std::pmr::memory_resource, so as that actors and results
+    can allocate from arenas, pools or specially mapped regions.
+
+    A resource given to an actor must be thread-safe: messages are
+    allocated by the threads which put them and released by the actor thread.
+ */
+class memory_resource {
+public:
+    /** the destructor.
+     */
+    virtual ~memory_resource() {}
+
+    /** allocates memory.
+        @param bytes number of bytes.
+        @return pointer to memory, aligned for any fundamental type.
+     */
+    void *allocate(size_t bytes) {
+        return do_allocate(bytes);
+    }
+
+    /** releases memory.
+        @param p pointer to memory returned by allocate().
+        @param bytes number of bytes passed to allocate().
+     */
+    void deallocate(void *p, size_t bytes) {
+        do_deallocate(p, bytes);
+    }
+
+protected:
+    /** allocates memory.
+        @param bytes number of bytes.
+        @return pointer to memory.
+     */
+    virtual void *do_allocate(size_t bytes) = 0;
+
+    /** releases memory.
+        @param p pointer to memory.
+        @param bytes number of bytes.
+     */
+    virtual void do_deallocate(void *p, size_t bytes) = 0;
+};
+
+
+/** returns the resource which uses the global operator new and delete.
+    @return the resource.
+ */
+memory_resource *new_delete_resource();
+
+
+/** a thread-safe resource which keeps released blocks for reuse.
+
+    Small blocks are rounded up to size classes of 16 bytes, and are
+    carved from large chunks taken from the upstream resource; released
+    blocks go to a free list per size class. Larger blocks are passed
+    to the upstream resource. Chunks are returned to the upstream resource
+    when the pool is destroyed.
+ */
+class pool_resource : public memory_resource {
+public:
+    /** the constructor.
+        @param upstream resource to take chunks from; if null, the global heap.
+        @param chunk_size size of chunks.
+        @param max_block maximum size of blocks kept in the pool.
+     */
+    pool_resource(memory_resource *upstream = 0, size_t chunk_size = 65536, size_t max_block = 512);
+
+    /** the destructor.
+        All the memory allocated from the pool is released.
+     */
+    ~pool_resource();
+
+protected:
+    //allocates memory
+    virtual void *do_allocate(size_t bytes);
+
+    //releases memory
+    virtual void do_deallocate(void *p, size_t bytes);
+
+private:
+    //a released block
+    struct free_block {
+        free_block *m_next;
+    };
+
+    //mutex
+    pthread_mutex_t m_mutex;
+
+    //upstream resource
+    memory_resource *m_upstream;
+
+    //sizes
+    size_t m_chunk_size;
+    size_t m_max_block;
+
+    //free lists, per size class
+    std::vector<free_block *> m_free;
+
+    //chunks, and the unused part of the last one
+    std::vector<void *> m_chunks;
+    char *m_chunk_ptr;
+    size_t m_chunk_left;
+
+    //not copyable
+    pool_resource(const pool_resource &);
+    pool_resource &operator = (const pool_resource &);
+};
+
+
+class actor;
+class supervisor;
+template <class Receiver> class schedule_operation;
+template <class R, class Receiver> class result_operation;
+template <class K, class V, class Hash> class kv_shard;
+template <class D, class T0, class T1, class T2, class T3, class T4, class T5, class T6, class T7> class typed_actor;
+
+
+/** a bump-pointer arena for the temporary data of a message handler.
+
+    Each actor has one; it is reset after every message, in O(1), so
+    the memory allocated from it is valid only until the handler returns.
+    Allocation is a pointer increment; there is no deallocation.
+    The blocks of the arena are kept for reuse after a reset.
+ */
+class scratch_arena {
+public:
+    /** the constructor.
+        No memory is allocated until the first allocation.
+        @param upstream resource to take blocks from; if null, the global heap.
+        @param block_size minimum size of blocks.
+     */
+    scratch_arena(memory_resource *upstream = 0, size_t block_size = 4096);
+
+    /** the destructor.
+     */
+    ~scratch_arena();
+
+    /** allocates memory.
+        @param bytes number of bytes.
+        @return pointer to memory, aligned for any fundamental type.
+     */
+    void *allocate(size_t bytes) {
+        bytes = (bytes + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+        if ((size_t)(m_end - m_ptr) < bytes) return allocate_block(bytes);
+        void *p = m_ptr;
+        m_ptr += bytes;
+        return p;
+    }
+
+    /** releases all the memory allocated from the arena.
+     */
+    void reset() {
+        m_block = m_first;
+        m_ptr = m_first ? m_first->begin() : 0;
+        m_end = m_first ? m_first->end() : 0;
+    }
+
+    /** releases all the memory allocated from the arena, and its blocks.
+     */
+    void release();
+
+    /** returns the arena of the actor which runs in the calling thread.
+        @return the arena, or null if the calling thread is not an actor thread.
+     */
+    static scratch_arena *current();
+
+private:
+    //alignment of allocations
+    enum { ALIGNMENT = 16 };
+
+    //a block; the memory follows the header
+    struct block {
+        block *m_next;
+        size_t m_size;
+
+        char *begin() {
+            return reinterpret_cast<char *>(this) + ALIGNMENT;
+        }
+
+        char *end() {
+            return begin() + m_size;
+        }
+    };
+
+    //members
+    memory_resource *m_upstream;
+    size_t m_block_size;
+    block *m_first;
+    block *m_block;
+    char *m_ptr;
+    char *m_end;
+
+    //not copyable
+    scratch_arena(const scratch_arena &);
+    scratch_arena &operator = (const scratch_arena &);
+
+    //moves to the next block which fits the allocation, creating it if needed
+    void *allocate_block(size_t bytes);
+
+    //sets the arena of the calling thread
+    static void set_current(scratch_arena *arena);
+
+    friend class actor;
+};
+
+
+/** an STL allocator which allocates from a scratch arena.
+    Deallocation does nothing; the memory is released when the arena is reset.
+    Without an arena, outside of an actor thread, it uses the global heap.
+    @param T type of allocated objects.
+ */
+template <class T> class scratch_allocator {
+public:
+    //allocator types
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    //rebinds the allocator to another type
+    template <class U> struct rebind {
+        typedef scratch_allocator<U> other;
+    };
+
+    /** constructs an allocator for the arena of the calling actor thread;
+        if the calling thread is not an actor thread, it uses the global heap.
+     */
+    scratch_allocator() : m_arena(scratch_arena::current()) {}
+
+    /** constructs an allocator for the given arena.
+        @param arena arena.
+     */
+    scratch_allocator(scratch_arena &arena) : m_arena(&arena) {}
+
+    /** the copy constructor, from any type.
+        @param a source object.
+     */
+    template <class U> scratch_allocator(const scratch_allocator<U> &a) : m_arena(a.arena()) {}
+
+    /** allocates objects.
+        @param n number of objects.
+        @return pointer to the objects.
+     */
+    pointer allocate(size_type n, const void * = 0) {
+        if (!m_arena) return static_cast<pointer>(::operator new(n * sizeof(T)));
+        return static_cast<pointer>(m_arena->allocate(n * sizeof(T)));
+    }
+
+    /** deallocates objects; it does nothing for an arena.
+        @param p pointer to the objects.
+     */
+    void deallocate(pointer p, size_type) {
+        if (!m_arena) ::operator delete(p);
+    }
+
+    /** constructs an object.
+        @param p pointer to memory.
+        @param v value.
+     */
+    void construct(pointer p, const T &v) {
+        new (static_cast<void *>(p)) T(v);
+    }
+
+    /** destroys an object.
+        @param p pointer to object.
+     */
+    void destroy(pointer p) {
+        p->~T();
+    }
+
+    /** returns the maximum number of objects.
+        @return the maximum number of objects.
+     */
+    size_type max_size() const {
+        return (size_type)-1 / sizeof(T);
+    }
+
+    /** returns the address of an object.
+        @param v object.
+        @return the address.
+     */
+    pointer address(reference v) const {
+        return &v;
+    }
+
+    /** returns the address of an object.
+        @param v object.
+        @return the address.
+     */
+    const_pointer address(const_reference v) const {
+        return &v;
+    }
+
+    /** returns the arena.
+        @return the arena; null for the global heap.
+     */
+    scratch_arena *arena() const {
+        return m_arena;
+    }
+
+private:
+    scratch_arena *m_arena;
+};
+
+
+/** compares two allocators.
+    @return true if they use the same arena.
+ */
+template <class T, class U> bool operator == (const scratch_allocator<T> &a, const scratch_allocator<U> &b) {
+    return a.arena() == b.arena();
+}
+
+
+/** compares two allocators.
+    @return true if they use different arenas.
+ */
+template <class T, class U> bool operator != (const scratch_allocator<T> &a, const scratch_allocator<U> &b) {
+    return a.arena() != b.arena();
+}
+
+
+/** a string allocated from the scratch arena of the calling actor thread.
+ */
+typedef std::basic_string<char, std::char_traits<char>, scratch_allocator<char> > scratch_string;
+
+
+/** a string stream allocated from the scratch arena of the calling actor thread.
+ */
+typedef std::basic_stringstream<char, std::char_traits<char>, scratch_allocator<char> > scratch_stringstream;
+
+
+/** returns the current time of a monotonic clock, which is not
+    affected by changes of the time of day; it is the time base of the
+    timers, deadlines and rates of the library.
+    @return the current time, in nanoseconds.
+ */
+unsigned long long now_ns();
+
+
+/** initializes a condition variable whose timed waits take
+    an absolute time of the clock of now_ns().
+    @param c condition variable.
+ */
+void monotonic_cond_init(pthread_cond_t *c);
+
+
+/** error thrown when getting a result whose computation failed.
+ */
+class actor_error : public std::runtime_error {
+public:
+    /** the constructor.
+        @param what description of the failure.
+     */
+    explicit actor_error(const std::string &what) : std::runtime_error(what) {}
+};
+
+
+/** result of an actor's computation.
+    The value is constructed in the shared state only when it is set,
+    so R needs no default constructor; it needs a copy constructor
+    only for the functions which copy the value.
+    Value-type class.
+    Not thread-safe; different values are thread-safe.
+    @param R type of result.
+ */
+template <class R> class result {
+public:
+    /** the default constructor.
+     */
+    result() : m_data(data::create(0)) {}
+
+    /** constructor with a memory resource for the shared state.
+        The resource must outlive all the copies of the result.
+        @param mr memory resource; if null, the global heap.
+     */
+    explicit result(memory_resource *mr) : m_data(data::create(mr)) {}
+
+    /** the copy constructor.
+        @param r source object.
+     */
+    result(const result<R> &r) : m_data(r.m_data) {
+        m_data->inc_ref();
+    }
+
+    /** the destructor.
+     */
+    ~result() {
+        m_data->dec_ref();
+    }
+
+    /** the assignment operator.
+        @param r source object.
+        @return reference to this.
+     */
+    result<R> &operator = (const result<R> &r) {
+        r.m_data->inc_ref();
+        m_data->dec_ref();
+        m_data = r.m_data;
+        return *this;
+    }
+
+    /** retrieves the value of the computation.
+        It blocks until the result is available.
+        @return the value of the computation.
+        @exception actor_error thrown if the computation failed.
+     */
+    R get() const {
+        return m_data->get();
+    }
+
+    /** retrieves a reference to the value of the computation, without copying it.
+        It blocks until the result is available. The reference is valid
+        while a copy of the result exists, and the value is not set again.
+        @return the value of the computation.
+        @exception actor_error thrown if the computation failed.
+     */
+    const R &value() const {
+        return m_data->value();
+    }
+
+#if ACTORLIB_HAS_MOVE
+    /** moves the value of the computation out of the result.
+        It blocks until the result is available. The copies of the result
+        share the value, so it should be called by only one of them.
+        @return the value of the computation.
+        @exception actor_error thrown if the computation failed.
+     */
+    R take() {
+        return std::move(const_cast<R &>(m_data->value()));
+    }
+#endif
+
+    /** waits until the result is available, or the computation fails.
+        @param ms maximum time to wait, in milliseconds.
+        @return true if the result is available, or the computation failed;
+            false if the time elapsed.
+     */
+    bool wait_for(unsigned long ms) const {
+        return m_data->wait(now_ns() + ms * 1000000ULL);
+    }
+
+    /** automatic conversion to value.
+        It calls the get() function.
+        @return the value of the computation.
+        @exception actor_error thrown if the computation failed.
+     */
+    operator R () const {
+        return m_data->get();
+    }
+
+    /** sets the value.
+        Any thread waiting on the result value will be awoken.
+        @param v new value.
+     */
+    void set(const R &v) {
+        m_data->construct(copier(v));
+    }
+
+    /** constructs the value in place, from one argument.
+        Any thread waiting on the result value will be awoken.
+        @param a1 argument of the constructor of the value.
+     */
+    template <class A1> void emplace(const A1 &a1) {
+        m_data->construct(constructor_1<A1>(a1));
+    }
+
+    /** constructs the value in place, from two arguments.
+        Any thread waiting on the result value will be awoken.
+        @param a1 first argument of the constructor of the value.
+        @param a2 second argument of the constructor of the value.
+     */
+    template <class A1, class A2> void emplace(const A1 &a1, const A2 &a2) {
+        m_data->construct(constructor_2<A1, A2>(a1, a2));
+    }
+
+#if ACTORLIB_HAS_MOVE
+    /** sets the value, moving it.
+        Any thread waiting on the result value will be awoken.
+        @param v new value.
+     */
+    void set(R &&v) {
+        m_data->construct(mover(v));
+    }
+#endif
+
+    /** fails the computation.
+        Any thread waiting on the result value will be awoken,
+        and get() throws an actor_error with the given description.
+        It has no effect if the value is already set.
+        @param what description of the failure.
+     */
+    void fail(const std::string &what) {
+        m_data->fail(what);
+    }
+
+    /** assignment from value.
+        It calls the set(v) function.
+        @param v new value.
+        @return reference to this.
+     */
+    result<R> &operator = (const R &v) {
+        set(v);
+        return *this;
+    }
+
+private:
+    //constructs the value as a copy
+    class copier {
+    public:
+        copier(const R &v) : m_v(v) {}
+        void operator ()(void *p) const { new (p) R(m_v); }
+    private:
+        const R &m_v;
+    };
+
+    //constructs the value from one argument
+    template <class A1> class constructor_1 {
+    public:
+        constructor_1(const A1 &a1) : m_a1(a1) {}
+        void operator ()(void *p) const { new (p) R(m_a1); }
+    private:
+        const A1 &m_a1;
+    };
+
+    //constructs the value from two arguments
+    template <class A1, class A2> class constructor_2 {
+    public:
+        constructor_2(const A1 &a1, const A2 &a2) : m_a1(a1), m_a2(a2) {}
+        void operator ()(void *p) const { new (p) R(m_a1, m_a2); }
+    private:
+        const A1 &m_a1;
+        const A2 &m_a2;
+    };
+
+#if ACTORLIB_HAS_MOVE
+    //constructs the value by moving it
+    class mover {
+    public:
+        mover(R &v) : m_v(v) {}
+        void operator ()(void *p) const { new (p) R(std::move(m_v)); }
+    private:
+        R &m_v;
+    };
+#endif
+
+    //a function called once when the result is set or fails, from the thread which
+    //sets or fails it, without the lock; it is deleted afterwards, and it must not throw
+    class continuation {
+    public:
+        //next continuation of the same result
+        continuation *m_next;
+
+        //constructor
+        continuation() : m_next(0) {}
+
+        //destructor
+        virtual ~continuation() {}
+
+        //called with the value
+        virtual void set(const R &v) = 0;
+
+        //called with the description of the failure
+        virtual void fail(const std::string &what) = 0;
+    };
+
+    //adds a continuation; it is called at once if the result is already set or failed
+    void then(continuation *c) const {
+        m_data->then(c);
+    }
+
+    //the internal result structure, shared by all threads
+    //The reference count is changed by any thread which copies a result,
+    //so it is kept apart from the value and its synchronization,
+    //which are used by the setting and the waiting threads.
+    struct data {
+        //reference count
+        volatile long m_ref_count;
+
+        //resource the object was allocated from; null for the global heap
+        memory_resource *m_resource;
+
+        //padding between the reference count and the value
+        char m_pad0[ACTORLIB_CACHE_LINE_SIZE];
+
+        //mutex
+        pthread_mutex_t m_mutex;
+
+        //wait condition
+        pthread_cond_t m_cond;
+
+        //storage of the result value, constructed when it is set;
+        //the union aligns it for any type
+        union {
+            char m_data[sizeof(R)];
+            long double m_align1;
+            long long m_align2;
+            void *m_align3;
+        } m_value;
+
+        //if value is set, and so constructed
+        bool m_value_set;
+
+        //if the computation failed
+        bool m_failed;
+
+        //description of the failure
+        std::string m_error;
+
+        //continuations to call when the value is set or failed
+        continuation *m_continuations;
+
+        //padding between the value and the next object in memory
+        char m_pad1[ACTORLIB_CACHE_LINE_SIZE];
+
+        //constructor
+        data(memory_resource *mr) : m_resource(mr), m_continuations(0) {
+            pthread_mutex_init(&m_mutex, NULL);
+            monotonic_cond_init(&m_cond);
+            m_ref_count = 1;
+            m_value_set = false;
+            m_failed = false;
+        }
+
+        //creates an object from the given resource
+        static data *create(memory_resource *mr) {
+            if (!mr) return new data(0);
+            void *p = mr->allocate(sizeof(data));
+            try {
+                return new (p) data(mr);
+            }
+            catch (...) {
+                mr->deallocate(p, sizeof(data));
+                throw;
+            }
+        }
+
+        //destroys the object and releases it to its resource
+        void destroy() {
+            memory_resource *mr = m_resource;
+            if (!mr) {
+                delete this;
+                return;
+            }
+            this->~data();
+            mr->deallocate(this, sizeof(data));
+        }
+
+        //destructor
+        ~data() {
+            while (m_continuations) {
+                continuation *c = m_continuations;
+                m_continuations = c->m_next;
+                delete c;
+            }
+            if (m_value_set) value_ptr()->~R();
+            pthread_cond_destroy(&m_cond);
+            pthread_mutex_destroy(&m_mutex);
+        }
+
+        //increment the reference count
+        void inc_ref() {
+            atomic_increment(&m_ref_count);
+        }
+
+        //decrements the reference count and deletes the object if it reaches 0
+        void dec_ref() {
+            if (atomic_decrement(&m_ref_count) == 0) destroy();
+        }
+
+        //returns the value storage
+        R *value_ptr() {
+            return reinterpret_cast<R *>(m_value.m_data);
+        }
+
+        //wait until the value is set or failed; throw if failed; synchronized by the caller
+        void wait_value() {
+            while (!m_value_set && !m_failed) pthread_cond_wait(&m_cond, &m_mutex);
+            if (!m_value_set) {
+                std::string error = m_error;
+                pthread_mutex_unlock(&m_mutex);
+                throw actor_error(error);
+            }
+        }
+
+        //get the value
+        R get() {
+            pthread_mutex_lock(&m_mutex);
+            wait_value();
+            try {
+                R r = *value_ptr();
+                pthread_mutex_unlock(&m_mutex);
+                return r;
+            }
+            catch (...) {
+                pthread_mutex_unlock(&m_mutex);
+                throw;
+            }
+        }
+
+        //get a reference to the value
+        R &value() {
+            pthread_mutex_lock(&m_mutex);
+            wait_value();
+            R &r = *value_ptr();
+            pthread_mutex_unlock(&m_mutex);
+            return r;
+        }
+
+        //wait until the value is set or failed, or the deadline
+        bool wait(unsigned long long deadline) {
+            timespec ts;
+            ts.tv_sec = (time_t)(deadline / 1000000000ULL);
+            ts.tv_nsec = (long)(deadline % 1000000000ULL);
+            pthread_mutex_lock(&m_mutex);
+            while (!m_value_set && !m_failed) {
+                if (pthread_cond_timedwait(&m_cond, &m_mutex, &ts) == ETIMEDOUT) break;
+            }
+            bool ready = m_value_set || m_failed;
+            pthread_mutex_unlock(&m_mutex);
+            return ready;
+        }
+
+        //set the value, constructing it with the given function; a previous value is destroyed
+        template <class F> void construct(const F &f) {
+            pthread_mutex_lock(&m_mutex);
+            if (m_value_set) {
+                m_value_set = false;
+                value_ptr()->~R();
+            }
+            try {
+                f(m_value.m_data);
+            }
+            catch (...) {
+                pthread_mutex_unlock(&m_mutex);
+                throw;
+            }
+            m_value_set = true;
+            continuation *c = m_continuations;
+            m_continuations = 0;
+            pthread_mutex_unlock(&m_mutex);
+            pthread_cond_broadcast(&m_cond);
+            call_continuations(c, true);
+        }
+
+        //fail the computation
+        void fail(const std::string &what) {
+            pthread_mutex_lock(&m_mutex);
+            continuation *c = 0;
+            if (!m_value_set && !m_failed) {
+                m_error = what;
+                m_failed = true;
+                c = m_continuations;
+                m_continuations = 0;
+            }
+            pthread_mutex_unlock(&m_mutex);
+            pthread_cond_broadcast(&m_cond);
+            call_continuations(c, false);
+        }
+
+        //add a continuation, or call it if the value is already set or failed
+        void then(continuation *c) {
+            pthread_mutex_lock(&m_mutex);
+            if (!m_value_set && !m_failed) {
+                c->m_next = m_continuations;
+                m_continuations = c;
+                pthread_mutex_unlock(&m_mutex);
+                return;
+            }
+            bool set = m_value_set;
+            pthread_mutex_unlock(&m_mutex);
+            call_continuations(c, set);
+        }
+
+        //calls and deletes a list of continuations, with the value or the failure
+        void call_continuations(continuation *c, bool set) {
+            while (c) {
+                continuation *next = c->m_next;
+                if (set) c->set(*value_ptr()); else c->fail(m_error);
+                delete c;
+                c = next;
+            }
+        }
+    };
+
+    //internal pointer to data
+    data *m_data;
+
+    friend class actor;
+    template <class T, class Receiver> friend class result_operation;
+};
+
+
+/** specialization for void result.
+ */
+template <> class result<void> {
+public:
+    /** the constructor.
+        There is no shared state, so the memory resource is not used.
+     */
+    explicit result(memory_resource * = 0) {}
+
+    /** does nothing; there is nobody to wait for a void result.
+     */
+    void fail(const std::string &) {}
+};
+
+
+/** a rate limiter, implementing the generic cell rate algorithm.
+
+    It keeps only the theoretical arrival time of the next call, which is
+    advanced with a compare-and-swap, so it takes no lock, and it can be
+    shared by many actors and threads.
+
+    When the burst allows, the tokens available now are taken in batches,
+    of up to an eighth of the burst and at most 64, and handed out as
+    credits; so a throttle which does not limit costs an atomic decrement
+    per call, and the clock is read once per batch. Credits left over
+    across an idle period may exceed the burst by less than a batch.
+ */
+class throttle {
+public:
+    /** the constructor.
+        @param rate calls per second.
+        @param burst number of calls allowed at once, after an idle period.
+     */
+    throttle(double rate, double burst = 1);
+
+    /** takes a token, if one is available now.
+        @return true if the token was taken.
+     */
+    bool try_acquire();
+
+    /** reserves a token, which may be available later.
+        @return time until the token is available, in nanoseconds;
+            0 if it is available now.
+     */
+    unsigned long long reserve();
+
+private:
+    //interval between calls, in nanoseconds
+    long long m_interval;
+
+    //how early a call may be, in nanoseconds
+    long long m_tolerance;
+
+    //theoretical arrival time of the next call, in nanoseconds
+    volatile long long m_tat;
+
+    //maximum number of tokens taken at once
+    long long m_batch;
+
+    //tokens taken ahead, and not handed out yet
+    volatile long m_credits;
+
+    //takes a credit, if there is one
+    bool take_credit();
+
+    //returns the theoretical arrival time after a call at the given time;
+    //if the call is allowed, as many more calls of the batch as the burst
+    //allows are charged too, and their number is stored in extra
+    long long advance(long long tat, long long now, long long &extra) const;
+
+    //not copyable
+    throttle(const throttle &);
+    throttle &operator = (const throttle &);
+};
+
+
+class timer;
+template <class A> class handle;
+
+
+/** the base class for all actors.
+
+    It provides the interface for posting messages to actors.
+
+    The messages are entered in queue, and then the actor's thread
+    is woken up to process the messages.
+
+    The messages are calls to the internal functions of the object.
+ */
+class actor {
+public:
+    /** constructs an actor.
+        The internal thread is started.
+        @param mr memory resource for the messages and the shared state
+            of the results; if null, the global heap. It must be thread-safe,
+            and outlive the actor and the results it returns.
+     */
+    explicit actor(memory_resource *mr = 0);
+
+    /** destroys an actor.
+        The calling thread blocks until the actor thread is terminated.
+     */
+    virtual ~actor();
+
+    /** hibernation statistics, for all the actors.
+     */
+    struct hibernation_stats {
+        //number of hibernated actors
+        long actors;
+
+        //total size of their serialized state
+        long bytes;
+    };
+
+    /** returns the hibernation statistics.
+        @return the statistics.
+     */
+    static hibernation_stats hibernation_statistics();
+
+    /** load shedding statistics of an actor.
+     */
+    struct shedding_stats {
+        //number of messages dropped because they expired
+        long expired;
+
+        //number of messages rejected by admission control
+        long rejected;
+
+        //number of messages rejected by the throttle
+        long throttled;
+    };
+
+    /** returns the load shedding statistics of the actor.
+        @return the statistics.
+     */
+    shedding_stats shedding_statistics() const;
+
+    /** sets the sender group of the calling thread.
+        Actors with publication slots or fair queuing put the messages of a
+        group in the same slot, the group modulo the number of slots.
+        By default, each thread is a group of its own, numbered in the order
+        the threads put their first message to such an actor.
+        @param group the group.
+     */
+    static void set_sender_group(unsigned long group);
+
+    /** what to do with a message put faster than the throttle allows.
+        THROTTLE_REJECT drops it, and fails its result; THROTTLE_BLOCK
+        makes the putting thread sleep until its turn; THROTTLE_DELAY
+        schedules it on a timer, so as that put returns immediately.
+     */
+    enum throttle_mode {
+        THROTTLE_REJECT,
+        THROTTLE_BLOCK,
+        THROTTLE_DELAY
+    };
+
+protected:
+    /** puts a message with 0 parameters.
+        @param f function to put.
+     */
+    template <class C, class R> result<R> put(R (C::*f)()) {
+        result<R> r(m_resource);
+        put(new (m_resource) object_message_0<C, R>(static_cast<C *>(this), r, f));
+        return r;
+    }
+
+    /** puts a message with 1 parameter.
+        @param f function to put.
+        @param t1 1st argument.
+     */
+    template <class C, class R, class T1> result<R> put(R (C::*f)(const T1 &), const T1 &t1) {
+        result<R> r(m_resource);
+        put(new (m_resource) object_message_1<C, R, T1>(static_cast<C *>(this), r, f, t1));
+        return r;
+    }
+
+    /** puts a message with 2 parameters.
+        @param f function to put.
+        @param t1 1st argument.
+        @param t2 2nd argument.
+     */
+    template <class C, class R, class T1, class T2> result<R> put(R (C::*f)(const T1 &, const T2 &), const T1 &t1, const T2 &t2) {
+        result<R> r(m_resource);
+        put(new (m_resource) object_message_2<C, R, T1, T2>(static_cast<C *>(this), r, f, t1, t2));
+        return r;
+    }
+
+    /** calls a function with 0 parameters, and waits for its value.
+        The message and the value are kept on the stack of the calling
+        thread, which waits on a semaphore of its own, so a call allocates
+        nothing. It must not be called from the thread of this actor.
+        @param f function to call.
+        @return the value of the function.
+        @exception actor_error thrown if the function threw, or the message
+            was rejected, expired or failed.
+     */
+    template <class C, class R> R call(R (C::*f)()) {
+        call_state<R> s;
+        call_message_0<C, R> msg(static_cast<C *>(this), s, f);
+        put(&msg);
+        s.m_parker.park();
+        return s.get();
+    }
+
+    /** calls a function with 1 parameter, and waits for its value.
+        The argument is not copied.
+        @param f function to call.
+        @param t1 1st argument.
+        @return the value of the function.
+        @exception actor_error thrown if the function threw, or the message
+            was rejected, expired or failed.
+     */
+    template <class C, class R, class T1> R call(R (C::*f)(const T1 &), const T1 &t1) {
+        call_state<R> s;
+        call_message_1<C, R, T1> msg(static_cast<C *>(this), s, f, t1);
+        put(&msg);
+        s.m_parker.park();
+        return s.get();
+    }
+
+    /** calls a function with 2 parameters, and waits for its value.
+        The arguments are not copied.
+        @param f function to call.
+        @param t1 1st argument.
+        @param t2 2nd argument.
+        @return the value of the function.
+        @exception actor_error thrown if the function threw, or the message
+            was rejected, expired or failed.
+     */
+    template <class C, class R, class T1, class T2> R call(R (C::*f)(const T1 &, const T2 &), const T1 &t1, const T2 &t2) {
+        call_state<R> s;
+        call_message_2<C, R, T1, T2> msg(static_cast<C *>(this), s, f, t1, t2);
+        put(&msg);
+        s.m_parker.park();
+        return s.get();
+    }
+
+    /** asks for a result, and has its value delivered to this actor as a message.
+        When the result is set, a message which calls the handler with
+        the value is put to this actor, so no thread waits for the result;
+        the reply is put by the thread which sets the result, and it is
+        never rejected, expired or throttled. It is dropped if this actor
+        is destroyed before. A failure of the computation is not delivered.
+        @param r result, usually returned by a function of another actor.
+        @param handler function of this actor to call with the value.
+     */
+    template <class C, class R> void ask(const result<R> &r, void (C::*handler)(const R &)) {
+        r.then(new reply_continuation<C, R>(static_cast<C *>(this), handler, 0));
+    }
+
+    /** asks for a result, and has its value or its failure delivered to this actor as a message.
+        As the other ask(), but, if the computation fails, a message which
+        calls the error handler with the description of the failure is put
+        instead.
+        @param r result, usually returned by a function of another actor.
+        @param handler function of this actor to call with the value.
+        @param error_handler function of this actor to call with the failure.
+     */
+    template <class C, class R> void ask(const result<R> &r, void (C::*handler)(const R &), void (C::*error_handler)(const std::string &)) {
+        r.then(new reply_continuation<C, R>(static_cast<C *>(this), handler, error_handler));
+    }
+
+    /** puts a message with 0 parameters, which expires after the given time.
+        If it is not executed before it expires, it is dropped,
+        and its result fails.
+        @param ttl_ms time to live, in milliseconds.
+        @param f function to put.
+     */
+    template <class C, class R> result<R> put_ttl(unsigned long ttl_ms, R (C::*f)()) {
+        result<R> r(m_resource);
+        message *msg = new (m_resource) object_message_0<C, R>(static_cast<C *>(this), r, f);
+        msg->m_deadline = now_ns() + ttl_ms * 1000000ULL;
+        put(msg);
+        return r;
+    }
+
+    /** puts a message with 1 parameter, which expires after the given time.
+        If it is not executed before it expires, it is dropped,
+        and its result fails.
+        @param ttl_ms time to live, in milliseconds.
+        @param f function to put.
+        @param t1 1st argument.
+     */
+    template <class C, class R, class T1> result<R> put_ttl(unsigned long ttl_ms, R (C::*f)(const T1 &), const T1 &t1) {
+        result<R> r(m_resource);
+        message *msg = new (m_resource) object_message_1<C, R, T1>(static_cast<C *>(this), r, f, t1);
+        msg->m_deadline = now_ns() + ttl_ms * 1000000ULL;
+        put(msg);
+        return r;
+    }
+
+    /** puts a message with 2 parameters, which expires after the given time.
+        If it is not executed before it expires, it is dropped,
+        and its result fails.
+        @param ttl_ms time to live, in milliseconds.
+        @param f function to put.
+        @param t1 1st argument.
+        @param t2 2nd argument.
+     */
+    template <class C, class R, class T1, class T2> result<R> put_ttl(unsigned long ttl_ms, R (C::*f)(const T1 &, const T2 &), const T1 &t1, const T2 &t2) {
+        result<R> r(m_resource);
+        message *msg = new (m_resource) object_message_2<C, R, T1, T2>(static_cast<C *>(this), r, f, t1, t2);
+        msg->m_deadline = now_ns() + ttl_ms * 1000000ULL;
+        put(msg);
+        return r;
+    }
+
+    /** puts a message with 1 parameter to a batch function.
+        Consecutive messages for the same batch function are executed
+        with one call, which receives the arguments of all of them,
+        in the order they were put.
+        The argument type must be default-constructible.
+        @param f batch function to put.
+        @param t1 1st argument.
+     */
+    template <class C, class T1> void put_batch(void (C::*f)(const std::vector<T1> &), const T1 &t1) {
+        if (!atomic_load(&m_batching)) atomic_store(&m_batching, 1);
+        put(new (m_resource) batch_message_1<C, T1>(static_cast<C *>(this), f, t1));
+    }
+
+    /** puts an event with 0 parameters.
+        The event is executed by the handler which the current behavior
+        has for it; see become(). If the behavior has no handler for it,
+        the result fails.
+        @param slot member of the behavior table with the handler of the event.
+     */
+    template <class C, class B, class R> result<R> put_event(R (C::*B::*slot)()) {
+        result<R> r(m_resource);
+        put(new (m_resource) event_message_0<C, B, R>(static_cast<C *>(this), r, slot));
+        return r;
+    }
+
+    /** puts an event with 1 parameter.
+        @param slot member of the behavior table with the handler of the event.
+        @param t1 1st argument.
+     */
+    template <class C, class B, class R, class T1> result<R> put_event(R (C::*B::*slot)(const T1 &), const T1 &t1) {
+        result<R> r(m_resource);
+        put(new (m_resource) event_message_1<C, B, R, T1>(static_cast<C *>(this), r, slot, t1));
+        return r;
+    }
+
+    /** puts an event with 2 parameters.
+        @param slot member of the behavior table with the handler of the event.
+        @param t1 1st argument.
+        @param t2 2nd argument.
+     */
+    template <class C, class B, class R, class T1, class T2> result<R> put_event(R (C::*B::*slot)(const T1 &, const T2 &), const T1 &t1, const T2 &t2) {
+        result<R> r(m_resource);
+        put(new (m_resource) event_message_2<C, B, R, T1, T2>(static_cast<C *>(this), r, slot, t1, t2));
+        return r;
+    }
+
+    /** switches the behavior of the actor.
+        A behavior is a table of handlers: a struct whose members are
+        pointers to member functions of the actor, one for each event;
+        a null member means that the behavior does not handle the event.
+        Switching is a pointer assignment, and dispatching an event is a load
+        from the table. An actor uses one table type for all its behaviors.
+        It must be called from the actor thread, or from the constructor.
+        @param b the new behavior; it must outlive its use, so tables
+            are usually static.
+        @param keep if true, the current behavior is kept, so as that
+            unbecome() returns to it; else it is replaced.
+     */
+    template <class B> void become(const B &b, bool keep = false) {
+        if (keep || m_behaviors.empty()) m_behaviors.push_back(&b); else m_behaviors.back() = &b;
+        m_behavior = &b;
+    }
+
+    /** returns to the previous behavior, kept by become().
+        It must be called from the actor thread.
+     */
+    void unbecome() {
+        if (m_behaviors.size() > 1) m_behaviors.pop_back();
+        if (!m_behaviors.empty()) m_behavior = m_behaviors.back();
+    }
+
+    /** returns the scratch arena of the actor.
+        Memory allocated from it is released after the current message.
+        It must be used only from the actor thread.
+        @return the scratch arena.
+     */
+    scratch_arena &scratch() {
+        return m_scratch;
+    }
+
+    /** puts the exit message in the message loop.
+        If this message is executed, the loop is terminated.
+     */
+    void exit() {
+        put_control(&actor::_exit);
+    }
+
+    /** puts the exit message and waits for the actor thread to terminate.
+        Messages already in the queue are executed first.
+        Derived actors whose internal functions use their own members
+        should call this from their destructor, so as that the queue
+        is drained before the members are destroyed.
+        It is safe to call it more than once, but only from one thread.
+        Handles to the actor no longer resolve from the start of the call,
+        which waits until the pins taken before are released.
+     */
+    void stop();
+
+    /** puts a message with no parameters which is never rejected, expired or throttled.
+        It is for derived classes which keep their own queues, and put
+        a message to have them processed by the actor thread.
+        @param f member function of the derived class.
+     */
+    template <class C> void put_control(void (C::*f)()) {
+        put_control(static_cast<void (actor::*)()>(f));
+    }
+
+    /** enables hibernation.
+        If the actor receives no message for the given time, it serializes
+        its state with hibernate() and its thread terminates. The next put
+        starts a new thread, which restores the state with rehydrate()
+        before executing the message.
+        @param idle_ms idle time, in milliseconds; 0 disables hibernation.
+     */
+    void enable_hibernation(unsigned long idle_ms) {
+        put_control(&actor::_enable_hibernation, idle_ms);
+    }
+
+    /** sets the time to live of the messages.
+        Messages not executed within this time after they are put are
+        dropped, and their results fail; put_ttl() overrides it for
+        a message. Control messages, such as exit, never expire.
+        @param ttl_ms time to live, in milliseconds; 0 disables it.
+     */
+    void set_message_ttl(unsigned long ttl_ms) {
+        atomic_store(&m_ttl, (long)(ttl_ms * 1000));
+    }
+
+    /** enables admission control.
+        The wait of the messages in the queue is measured when they are
+        executed; while it exceeds the given target, new messages are rejected,
+        and their results fail, so as that the actor catches up instead of
+        executing messages too old to matter.
+        @param max_wait_ms target wait, in milliseconds; 0 disables it.
+     */
+    void set_admission_limit(unsigned long max_wait_ms) {
+        atomic_store(&m_max_wait, (long)(max_wait_ms * 1000));
+    }
+
+    /** limits the rate of the messages put to the actor.
+        It must be called before the actor is shared with other threads,
+        typically from the constructor. Control messages are not limited.
+        @param t throttle; null to remove it. It can be shared by many actors,
+            for a common limit, and must outlive the actor.
+        @param mode what to do with excess messages.
+        @param tm timer for THROTTLE_DELAY; it must outlive the actor.
+            Without a timer, THROTTLE_DELAY blocks.
+     */
+    void set_throttle(throttle *t, throttle_mode mode = THROTTLE_REJECT, timer *tm = 0) {
+        m_throttle = t;
+        m_throttle_mode = mode;
+        m_throttle_timer = tm;
+    }
+
+    /** gives the actor a mailbox of publication slots, for many producers.
+        Each thread puts its messages in one of the slots, each in its own
+        cache line, without taking the mutex of the actor, and only the put
+        which finds the actor thread not signalled wakes it up. The actor
+        thread gathers the messages of all the slots at once.
+        Messages put by one thread are executed in order, but messages put
+        by different threads may be executed in a different order than
+        they were put, even if one put happens before the other.
+        It must be called before the actor is shared with other threads,
+        typically from the constructor, and at most once.
+        @param count number of slots; threads beyond it share slots.
+     */
+    void enable_publication_slots(unsigned long count = 32);
+
+    /** makes the actor execute the messages of its senders in turn.
+        The messages are put in publication slots, as with
+        enable_publication_slots(), and the actor thread keeps the messages
+        of each slot in a queue of its own. It executes up to the given
+        number of messages from each non-empty queue in turn, so as that
+        a sender which floods the actor delays the others by one turn,
+        instead of by all its messages. The threads of a sender group share
+        a queue; see set_sender_group(). Messages put at the front, such
+        as by the supervisor, are executed first.
+        It must be called before the actor is shared with other threads,
+        typically from the constructor, and at most once.
+        @param quantum number of messages executed from a queue per turn.
+        @param count number of queues, if publication slots are not enabled already.
+     */
+    void enable_fair_queuing(unsigned long quantum = 16, unsigned long count = 32);
+
+    /** serializes the state of the actor and releases it.
+        Invoked in the actor thread when the actor hibernates.
+        The default implementation does nothing.
+        @param blob string to serialize the state to.
+     */
+    virtual void hibernate(std::string &blob) {
+    }
+
+    /** restores the state of the actor.
+        Invoked in the actor thread, before the first message after hibernation.
+        The default implementation does nothing.
+        @param blob the string that hibernate() serialized the state to.
+     */
+    virtual void rehydrate(const std::string &blob) {
+    }
+
+    /** resets the state of the actor after a failure.
+        Invoked in the actor thread, when the supervisor restarts the actor;
+        the messages in the queue are kept, and executed after it.
+        The default implementation does nothing.
+     */
+    virtual void restart() {
+    }
+
+    /** stashes the current message.
+        When the handler returns, the message is moved to the stash of the
+        actor, without being copied, instead of being deleted, and its result
+        is not set. It must be called from the handler of the message.
+     */
+    void stash() {
+        m_stash_current = true;
+    }
+
+    /** moves all the stashed messages to the front of the queue, in the order
+        they were stashed, so as that they are executed next.
+        It must be called from the actor thread.
+     */
+    void unstash_all() {
+        m_pending.splice_front(m_stash);
+    }
+
+    /** returns the number of stashed messages.
+        It must be called from the actor thread.
+        @return the number of stashed messages.
+     */
+    size_t stash_size() const {
+        return m_stash.size();
+    }
+
+private:
+    //invoke object with a non-void result
+    template <class C, class R> class invoker {
+    public:
+        //sets the result, unless the message was stashed
+        static void set(result<R> &r, C *o, const R &v) {
+            if (!static_cast<actor *>(o)->m_stash_current) r.set(v);
+        }
+
+#if ACTORLIB_HAS_MOVE
+        //sets the result by moving the returned value, unless the message was stashed
+        static void set(result<R> &r, C *o, R &&v) {
+            if (!static_cast<actor *>(o)->m_stash_current) r.set(std::move(v));
+        }
+#endif
+
+        //invoke with 0 params
+        static void exec(result<R> &r, C *o, R (C::*f)()) {
+            set(r, o, (o->*f)());
+        }
+
+        //invoke with 1 param
+        template <class T1> static void exec(result<R> &r, C *o, R (C::*f)(const T1 &), const T1 &t1) {
+            set(r, o, (o->*f)(t1));
+        }
+
+        //invoke with 2 params
+        template <class T1, class T2>
+        static void exec(result<R> &r, C *o,
+            R (C::*f)(const T1 &, const T2 &),
+            const T1 &t1, const T2 &t2)
+        {
+            set(r, o, (o->*f)(t1, t2));
+        }
+
+        //invoke with 3 params
+        template <class T1, class T2, class T3>
+        static void exec(result<R> &r, C *o,
+            R (C::*f)(const T1 &, const T2 &, const T3 &),
+            const T1 &t1, const T2 &t2, const T3 &t3)
+        {
+            set(r, o, (o->*f)(t1, t2, t3));
+        }
+
+        //invoke with 4 params
+        template <class T1, class T2, class T3, class T4>
+        static void exec(result<R> &r, C *o,
+            R (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4)
+        {
+            set(r, o, (o->*f)(t1, t2, t3, t4));
+        }
+
+        //invoke with 5 params
+        template <class T1, class T2, class T3, class T4, class T5>
+        static void exec(result<R> &r, C *o,
+            R (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5)
+        {
+            set(r, o, (o->*f)(t1, t2, t3, t4, t5));
+        }
+
+        //invoke with 6 params
+        template <class T1, class T2, class T3, class T4, class T5, class T6>
+        static void exec(result<R> &r, C *o,
+            R (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6)
+        {
+            set(r, o, (o->*f)(t1, t2, t3, t4, t5, t6));
+        }
+
+        //invoke with 7 params
+        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7>
+        static void exec(result<R> &r, C *o,
+            R (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7)
+        {
+            set(r, o, (o->*f)(t1, t2, t3, t4, t5, t6, t7));
+        }
+
+        //invoke with 8 params
+        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8>
+        static void exec(result<R> &r, C *o,
+            R (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8)
+        {
+            set(r, o, (o->*f)(t1, t2, t3, t4, t5, t6, t7, t8));
+        }
+
+        //invoke with 9 params
+        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8, class T9>
+        static void exec(result<R> &r, C *o,
+            R (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &, const T9 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8, const T9 &t9)
+        {
+            set(r, o, (o->*f)(t1, t2, t3, t4, t5, t6, t7, t8, t9));
+        }
+    };
+
+    //specialization for void
+    template <class C> class invoker<C, void> {
+    public:
+        //invoke with 0 params
+        static void exec(result<void> &r, C *o, void (C::*f)()) {
+            (o->*f)();
+        }
+
+        //invoke with 1 param
+        template <class T1> static void exec(result<void> &r, C *o, void (C::*f)(const T1 &), const T1 &t1) {
+            (o->*f)(t1);
+        }
+
+        //invoke with 2 params
+        template <class T1, class T2>
+        static void exec(result<void> &r, C *o,
+            void (C::*f)(const T1 &, const T2 &),
+            const T1 &t1, const T2 &t2)
+        {
+            (o->*f)(t1, t2);
+        }
+
+        //invoke with 3 params
+        template <class T1, class T2, class T3>
+        static void exec(result<void> &r, C *o,
+            void (C::*f)(const T1 &, const T2 &, const T3 &),
+            const T1 &t1, const T2 &t2, const T3 &t3)
+        {
+            (o->*f)(t1, t2, t3);
+        }
+
+        //invoke with 4 params
+        template <class T1, class T2, class T3, class T4>
+        static void exec(result<void> &r, C *o,
+            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4)
+        {
+            (o->*f)(t1, t2, t3, t4);
+        }
+
+        //invoke with 5 params
+        template <class T1, class T2, class T3, class T4, class T5>
+        static void exec(result<void> &r, C *o,
+            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5)
+        {
+            (o->*f)(t1, t2, t3, t4, t5);
+        }
+
+        //invoke with 6 params
+        template <class T1, class T2, class T3, class T4, class T5, class T6>
+        static void exec(result<void> &r, C *o,
+            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6)
+        {
+            (o->*f)(t1, t2, t3, t4, t5, t6);
+        }
+
+        //invoke with 7 params
+        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7>
+        static void exec(result<void> &r, C *o,
+            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7)
+        {
+            (o->*f)(t1, t2, t3, t4, t5, t6, t7);
+        }
+
+        //invoke with 8 params
+        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8>
+        static void exec(result<void> &r, C *o,
+            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8)
+        {
+            (o->*f)(t1, t2, t3, t4, t5, t6, t7, t8);
+        }
+
+        //invoke with 9 params
+        template <class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8, class T9>
+        static void exec(result<void> &r, C *o,
+            void (C::*f)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &, const T9 &),
+            const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8, const T9 &t9)
+        {
+            (o->*f)(t1, t2, t3, t4, t5, t6, t7, t8, t9);
+        }
+    };
+
+    //the header of an allocated message
+    struct header {
+        memory_resource *m_resource;
+        size_t m_size;
+    };
+
+    //size of the header; it keeps the message aligned for any fundamental type
+    enum { HEADER_SIZE = 16 };
+
+    //a message
+    class message {
+    public:
+        //next message in the queue
+        message *m_next;
+
+        //time the message was put, in nanoseconds; 0 if not measured
+        unsigned long long m_time;
+
+        //time the message expires, in nanoseconds; 0 if never
+        unsigned long long m_deadline;
+
+        //tag of the type of a batch message; only messages with the same tag are merged
+        const void *m_batch_tag;
+
+        //constructor
+        message() : m_next(0), m_time(0), m_deadline(0), m_batch_tag(0) {}
+
+        //virtual destructor due to virtual implementation.
+        virtual ~message() {}
+
+        //allocates a message from the given resource, or the global heap if null;
+        //the resource and the size are kept in a header before the message
+        static void *operator new(size_t size, memory_resource *mr) {
+            size += HEADER_SIZE;
+            char *p = static_cast<char *>(mr ? mr->allocate(size) : ::operator new(size));
+            reinterpret_cast<header *>(p)->m_resource = mr;
+            reinterpret_cast<header *>(p)->m_size = size;
+            return p + HEADER_SIZE;
+        }
+
+        //releases a message
+        static void operator delete(void *p) {
+            header *h = reinterpret_cast<header *>(static_cast<char *>(p) - HEADER_SIZE);
+            if (h->m_resource) h->m_resource->deallocate(h, h->m_size);
+            else ::operator delete(h);
+        }
+
+        //releases a message whose constructor threw
+        static void operator delete(void *p, memory_resource *) {
+            operator delete(p);
+        }
+
+        //interface for executing the message
+        virtual void exec() = 0;
+
+        //merges the given message, which has the same batch tag, into this, if possible;
+        //on success, the given message can be deleted.
+        virtual bool merge(message *) {
+            return false;
+        }
+
+        //fails the result of a message which is not executed, or which threw
+        virtual void fail(const std::string &) {
+        }
+
+        //releases the message after it is executed or failed
+        virtual void release() {
+            delete this;
+        }
+    };
+
+    //a message with a specific target object and result
+    template <class C, class R> class object_message : public message {
+    public:
+        //object
+        C *m_object;
+
+        //result variable
+        result<R> m_result;
+
+        //constructor.
+        object_message(C *object, const result<R> &r) :
+            m_object(object), m_result(r) {}
+
+        //fails the result
+        virtual void fail(const std::string &what) {
+            m_result.fail(what);
+        }
+    };
+
+    //a message with zero parameters
+    template <class C, class R> class object_message_0 : public object_message<C, R> {
+    public:
+        //function type
+        typedef R (C::*function)();
+
+        //function
+        function m_function;
+
+        //constructor.
+        object_message_0(C *object, const result<R> &r, function f) :
+            object_message<C, R>(object, r), m_function(f) {}
+
+        //calls the function
+        virtual void exec() {
+            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function);
+        }
+    };
+
+    //a message with 1 parameter
+    template <class C, class R, class T1>
+    class object_message_1 :
+        public object_message<C, R>
+    {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &);
+
+        //function
+        function m_function;
+
+        //argument 1
+        T1 m_t1;
+
+        //constructor.
+        object_message_1(C *object, const result<R> &r, function f, const T1 &t1) :
+            object_message<C, R>(object, r), m_function(f), m_t1(t1) {}
+
+        //calls the function
+        virtual void exec() {
+            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1);
+        }
+    };
+
+    //a message with 2 parameters
+    template <class C, class R, class T1, class T2>
+    class object_message_2 :
+        public object_message<C, R>
+    {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &, const T2 &);
+
+        //function
+        function m_function;
+
+        //arguments
+        T1 m_t1;
+        T2 m_t2;
+
+        //constructor.
+        object_message_2(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2) :
+            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2) {}
+
+        //calls the function
+        virtual void exec() {
+            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2);
+        }
+    };
+
+    //a message with 3 parameters
+    template <class C, class R, class T1, class T2, class T3>
+    class object_message_3 :
+        public object_message<C, R>
+    {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &, const T2 &, const T3 &);
+
+        //function
+        function m_function;
+
+        //arguments
+        T1 m_t1;
+        T2 m_t2;
+        T3 m_t3;
+
+        //constructor.
+        object_message_3(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3) :
+            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3) {}
+
+        //calls the function
+        virtual void exec() {
+            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3);
+        }
+    };
+
+    //a message with 4 parameters
+    template <class C, class R, class T1, class T2, class T3, class T4>
+    class object_message_4 :
+        public object_message<C, R>
+    {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &);
+
+        //function
+        function m_function;
+
+        //arguments
+        T1 m_t1;
+        T2 m_t2;
+        T3 m_t3;
+        T4 m_t4;
+
+        //constructor.
+        object_message_4(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4) :
+            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4) {}
+
+        //calls the function
+        virtual void exec() {
+            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4);
+        }
+    };
+
+    //a message with 5 parameters
+    template <class C, class R, class T1, class T2, class T3, class T4, class T5>
+    class object_message_5 :
+        public object_message<C, R>
+    {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &);
+
+        //function
+        function m_function;
+
+        //arguments
+        T1 m_t1;
+        T2 m_t2;
+        T3 m_t3;
+        T4 m_t4;
+        T5 m_t5;
+
+        //constructor.
+        object_message_5(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5) :
+            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4), m_t5(t5) {}
+
+        //calls the function
+        virtual void exec() {
+            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4, m_t5);
+        }
+    };
+
+    //a message with 6 parameters
+    template <class C, class R, class T1, class T2, class T3, class T4, class T5, class T6>
+    class object_message_6 :
+        public object_message<C, R>
+    {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &);
+
+        //function
+        function m_function;
+
+        //arguments
+        T1 m_t1;
+        T2 m_t2;
+        T3 m_t3;
+        T4 m_t4;
+        T5 m_t5;
+        T6 m_t6;
+
+        //constructor.
+        object_message_6(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6) :
+            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4), m_t5(t5), m_t6(t6) {}
+
+        //calls the function
+        virtual void exec() {
+            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4, m_t5, m_t6);
+        }
+    };
+
+    //a message with 7 parameters
+    template <class C, class R, class T1, class T2, class T3, class T4, class T5, class T6, class T7>
+    class object_message_7 :
+        public object_message<C, R>
+    {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &);
+
+        //function
+        function m_function;
+
+        //arguments
+        T1 m_t1;
+        T2 m_t2;
+        T3 m_t3;
+        T4 m_t4;
+        T5 m_t5;
+        T6 m_t6;
+        T7 m_t7;
+
+        //constructor.
+        object_message_7(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7) :
+            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4), m_t5(t5), m_t6(t6), m_t7(t7) {}
+
+        //calls the function
+        virtual void exec() {
+            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4, m_t5, m_t6, m_t7);
+        }
+    };
+
+    //a message with 8 parameters
+    template <class C, class R, class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8>
+    class object_message_8 :
+        public object_message<C, R>
+    {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &);
+
+        //function
+        function m_function;
+
+        //arguments
+        T1 m_t1;
+        T2 m_t2;
+        T3 m_t3;
+        T4 m_t4;
+        T5 m_t5;
+        T6 m_t6;
+        T7 m_t7;
+        T8 m_t8;
+
+        //constructor.
+        object_message_8(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8) :
+            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4), m_t5(t5), m_t6(t6), m_t7(t7), m_t8(t8) {}
+
+        //calls the function
+        virtual void exec() {
+            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4, m_t5, m_t6, m_t7, m_t8);
+        }
+    };
+
+    //a message with 9 parameters
+    template <class C, class R, class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8, class T9>
+    class object_message_9 :
+        public object_message<C, R>
+    {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &, const T2 &, const T3 &, const T4 &, const T5 &, const T6 &, const T7 &, const T8 &, const T9 &);
+
+        //function
+        function m_function;
+
+        //arguments
+        T1 m_t1;
+        T2 m_t2;
+        T3 m_t3;
+        T4 m_t4;
+        T5 m_t5;
+        T6 m_t6;
+        T7 m_t7;
+        T8 m_t8;
+        T9 m_t9;
+
+        //constructor.
+        object_message_9(C *object, const result<R> &r, function f, const T1 &t1, const T2 &t2, const T3 &t3, const T4 &t4, const T5 &t5, const T6 &t6, const T7 &t7, const T8 &t8, const T9 &t9) :
+            object_message<C, R>(object, r), m_function(f), m_t1(t1), m_t2(t2), m_t3(t3), m_t4(t4), m_t5(t5), m_t6(t6), m_t7(t7), m_t8(t8), m_t9(t9) {}
+
+        //calls the function
+        virtual void exec() {
+            invoker<C, R>::exec(this->m_result, this->m_object, this->m_function, m_t1, m_t2, m_t3, m_t4, m_t5, m_t6, m_t7, m_t8, m_t9);
+        }
+    };
+
+    //a message with 1 parameter to a batch function
+    template <class C, class T1> class batch_message_1 : public message {
+    public:
+        //function type
+        typedef void (C::*function)(const std::vector<T1> &);
+
+        //object
+        C *m_object;
+
+        //function
+        function m_function;
+
+        //argument of this message
+        T1 m_t1;
+
+        //arguments of merged messages, including the above
+        std::vector<T1> m_batch;
+
+        //constructor.
+        batch_message_1(C *object, function f, const T1 &t1) :
+            m_object(object), m_function(f), m_t1(t1)
+        {
+            this->m_batch_tag = tag();
+        }
+
+        //returns the tag of the type; the address of a constant, one per type
+        static const void *tag() {
+            static const char t = 0;
+            return &t;
+        }
+
+        //calls the function
+        virtual void exec() {
+            if (m_batch.empty()) {
+                m_batch.resize(1);
+                std::swap(m_batch[0], m_t1);
+            }
+            (m_object->*m_function)(m_batch);
+        }
+
+        //merges a message for the same function and object; the tag says it is of this type
+        virtual bool merge(message *msg) {
+            batch_message_1<C, T1> *other = static_cast<batch_message_1<C, T1> *>(msg);
+            if (other->m_function != m_function || other->m_object != m_object) return false;
+            if (m_batch.empty()) {
+                m_batch.resize(1);
+                std::swap(m_batch[0], m_t1);
+            }
+            m_batch.resize(m_batch.size() + 1);
+            std::swap(m_batch.back(), other->m_t1);
+            return true;
+        }
+    };
+
+    //an event; its handler is taken from the behavior of the actor, when executed
+    template <class C, class B, class R> class event_message : public object_message<C, R> {
+    public:
+        //constructor.
+        event_message(C *object, const result<R> &r) :
+            object_message<C, R>(object, r) {}
+
+        //returns the behavior of the actor
+        const B *behavior() const {
+            return static_cast<const B *>(static_cast<actor *>(this->m_object)->m_behavior);
+        }
+
+        //fails the result, for an event the behavior has no handler for
+        void unhandled() {
+            this->m_result.fail("event not handled");
+        }
+    };
+
+    //an event with 0 parameters
+    template <class C, class B, class R> class event_message_0 : public event_message<C, B, R> {
+    public:
+        //function type
+        typedef R (C::*function)();
+
+        //member of the behavior table
+        function B::*m_slot;
+
+        //constructor.
+        event_message_0(C *object, const result<R> &r, function B::*slot) :
+            event_message<C, B, R>(object, r), m_slot(slot) {}
+
+        //calls the handler of the current behavior
+        virtual void exec() {
+            const B *b = this->behavior();
+            if (!b || !(b->*m_slot)) {
+                this->unhandled();
+                return;
+            }
+            invoker<C, R>::exec(this->m_result, this->m_object, b->*m_slot);
+        }
+    };
+
+    //an event with 1 parameter
+    template <class C, class B, class R, class T1> class event_message_1 : public event_message<C, B, R> {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &);
+
+        //member of the behavior table
+        function B::*m_slot;
+
+        //argument 1
+        T1 m_t1;
+
+        //constructor.
+        event_message_1(C *object, const result<R> &r, function B::*slot, const T1 &t1) :
+            event_message<C, B, R>(object, r), m_slot(slot), m_t1(t1) {}
+
+        //calls the handler of the current behavior
+        virtual void exec() {
+            const B *b = this->behavior();
+            if (!b || !(b->*m_slot)) {
+                this->unhandled();
+                return;
+            }
+            invoker<C, R>::exec(this->m_result, this->m_object, b->*m_slot, m_t1);
+        }
+    };
+
+    //an event with 2 parameters
+    template <class C, class B, class R, class T1, class T2> class event_message_2 : public event_message<C, B, R> {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &, const T2 &);
+
+        //member of the behavior table
+        function B::*m_slot;
+
+        //argument 1
+        T1 m_t1;
+
+        //argument 2
+        T2 m_t2;
+
+        //constructor.
+        event_message_2(C *object, const result<R> &r, function B::*slot, const T1 &t1, const T2 &t2) :
+            event_message<C, B, R>(object, r), m_slot(slot), m_t1(t1), m_t2(t2) {}
+
+        //calls the handler of the current behavior
+        virtual void exec() {
+            const B *b = this->behavior();
+            if (!b || !(b->*m_slot)) {
+                this->unhandled();
+                return;
+            }
+            invoker<C, R>::exec(this->m_result, this->m_object, b->*m_slot, m_t1, m_t2);
+        }
+    };
+
+    //a semaphore per thread, on which a thread waits for the reply of a call
+    class parker {
+    public:
+        //returns the parker of the calling thread, creating it on first use
+        static parker &current();
+
+        //waits until the thread is unparked
+        void park();
+
+        //unparks the waiting thread
+        void unpark();
+
+    private:
+        //semaphore
+        sem_t m_sem;
+
+        //constructor
+        parker();
+
+        //destructor
+        ~parker();
+
+        //creates the key of the parkers
+        static void create_key();
+
+        //deletes the parker of a terminating thread
+        static void destroy(void *p);
+
+        //not copyable
+        parker(const parker &);
+        parker &operator = (const parker &);
+    };
+
+    //the state of a call, on the stack of the calling thread;
+    //the value is constructed in place when the call returns
+    template <class R, class Dummy = void> class call_state {
+    public:
+        //the parker of the calling thread
+        parker &m_parker;
+
+        //if the call failed, and the description of the failure
+        bool m_failed;
+        std::string m_error;
+
+        //constructor
+        call_state() : m_parker(parker::current()), m_failed(false), m_value_set(false) {}
+
+        //destructor
+        ~call_state() {
+            if (m_value_set) value_ptr()->~R();
+        }
+
+        //sets the value
+        void set(const R &v) {
+            new (m_value.m_data) R(v);
+            m_value_set = true;
+        }
+
+#if ACTORLIB_HAS_MOVE
+        //sets the value, moving it
+        void set(R &&v) {
+            new (m_value.m_data) R(std::move(v));
+            m_value_set = true;
+        }
+#endif
+
+        //returns the value, after the message is released; throws if the call failed
+        R get() {
+            if (m_failed) throw actor_error(m_error);
+#if ACTORLIB_HAS_MOVE
+            return std::move(*value_ptr());
+#else
+            return *value_ptr();
+#endif
+        }
+
+    private:
+        //storage of the value; the union aligns it for any type
+        union {
+            char m_data[sizeof(R)];
+            long double m_align1;
+            long long m_align2;
+            void *m_align3;
+        } m_value;
+
+        //if the value is constructed
+        bool m_value_set;
+
+        //returns the value storage
+        R *value_ptr() {
+            return reinterpret_cast<R *>(m_value.m_data);
+        }
+    };
+
+    //the state of a call without a value
+    template <class Dummy> class call_state<void, Dummy> {
+    public:
+        //the parker of the calling thread
+        parker &m_parker;
+
+        //if the call failed, and the description of the failure
+        bool m_failed;
+        std::string m_error;
+
+        //constructor
+        call_state() : m_parker(parker::current()), m_failed(false) {}
+
+        //throws if the call failed
+        void get() {
+            if (m_failed) throw actor_error(m_error);
+        }
+    };
+
+    //calls a function for a call message, and sets the value of the call
+    template <class C, class R> class call_invoker {
+    public:
+        //sets the value, unless the message was stashed
+        static void set(call_state<R> &s, C *o, const R &v) {
+            if (!static_cast<actor *>(o)->m_stash_current) s.set(v);
+        }
+
+#if ACTORLIB_HAS_MOVE
+        //sets the value by moving the returned value, unless the message was stashed
+        static void set(call_state<R> &s, C *o, R &&v) {
+            if (!static_cast<actor *>(o)->m_stash_current) s.set(std::move(v));
+        }
+#endif
+
+        //invoke with 0 params
+        static void exec(call_state<R> &s, C *o, R (C::*f)()) {
+            set(s, o, (o->*f)());
+        }
+
+        //invoke with 1 param
+        template <class T1> static void exec(call_state<R> &s, C *o, R (C::*f)(const T1 &), const T1 &t1) {
+            set(s, o, (o->*f)(t1));
+        }
+
+        //invoke with 2 params
+        template <class T1, class T2> static void exec(call_state<R> &s, C *o, R (C::*f)(const T1 &, const T2 &), const T1 &t1, const T2 &t2) {
+            set(s, o, (o->*f)(t1, t2));
+        }
+    };
+
+    //calls a function without a value for a call message
+    template <class C> class call_invoker<C, void> {
+    public:
+        //invoke with 0 params
+        static void exec(call_state<void> &, C *o, void (C::*f)()) {
+            (o->*f)();
+        }
+
+        //invoke with 1 param
+        template <class T1> static void exec(call_state<void> &, C *o, void (C::*f)(const T1 &), const T1 &t1) {
+            (o->*f)(t1);
+        }
+
+        //invoke with 2 params
+        template <class T1, class T2> static void exec(call_state<void> &, C *o, void (C::*f)(const T1 &, const T2 &), const T1 &t1, const T2 &t2) {
+            (o->*f)(t1, t2);
+        }
+    };
+
+    //a message of a call, on the stack of the calling thread;
+    //it refers to the arguments, which live until the call returns,
+    //and, when released, it unparks the calling thread instead of being deleted
+    template <class C, class R> class call_message : public message {
+    public:
+        //object
+        C *m_object;
+
+        //state of the call
+        call_state<R> &m_state;
+
+        //constructor
+        call_message(C *object, call_state<R> &s) : m_object(object), m_state(s) {}
+
+        //fails the call
+        virtual void fail(const std::string &what) {
+            m_state.m_error = what;
+            m_state.m_failed = true;
+        }
+
+        //unparks the calling thread; the message must not be used afterwards
+        virtual void release() {
+            m_state.m_parker.unpark();
+        }
+    };
+
+    //a call message with zero parameters
+    template <class C, class R> class call_message_0 : public call_message<C, R> {
+    public:
+        //function type
+        typedef R (C::*function)();
+
+        //function
+        function m_function;
+
+        //constructor
+        call_message_0(C *object, call_state<R> &s, function f) :
+            call_message<C, R>(object, s), m_function(f) {}
+
+        //execute
+        virtual void exec() {
+            call_invoker<C, R>::exec(this->m_state, this->m_object, m_function);
+        }
+    };
+
+    //a call message with one parameter
+    template <class C, class R, class T1> class call_message_1 : public call_message<C, R> {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &);
+
+        //function
+        function m_function;
+
+        //argument 1
+        const T1 &m_t1;
+
+        //constructor
+        call_message_1(C *object, call_state<R> &s, function f, const T1 &t1) :
+            call_message<C, R>(object, s), m_function(f), m_t1(t1) {}
+
+        //execute
+        virtual void exec() {
+            call_invoker<C, R>::exec(this->m_state, this->m_object, m_function, m_t1);
+        }
+    };
+
+    //a call message with two parameters
+    template <class C, class R, class T1, class T2> class call_message_2 : public call_message<C, R> {
+    public:
+        //function type
+        typedef R (C::*function)(const T1 &, const T2 &);
+
+        //function
+        function m_function;
+
+        //argument 1
+        const T1 &m_t1;
+
+        //argument 2
+        const T2 &m_t2;
+
+        //constructor
+        call_message_2(C *object, call_state<R> &s, function f, const T1 &t1, const T2 &t2) :
+            call_message<C, R>(object, s), m_function(f), m_t1(t1), m_t2(t2) {}
+
+        //execute
+        virtual void exec() {
+            call_invoker<C, R>::exec(this->m_state, this->m_object, m_function, m_t1, m_t2);
+        }
+    };
+
+    //the continuation of an asked result; it puts the reply to the asking actor
+    template <class C, class R> class reply_continuation : public result<R>::continuation {
+    public:
+        //function types
+        typedef void (C::*handler)(const R &);
+        typedef void (C::*error_handler)(const std::string &);
+
+        //constructor
+        reply_continuation(C *object, handler h, error_handler e) : m_actor(object), m_handler(h), m_error_handler(e) {}
+
+        //puts the value
+        virtual void set(const R &v) {
+            reply(m_handler, v);
+        }
+
+        //puts the failure, if there is an error handler
+        virtual void fail(const std::string &what) {
+            if (m_error_handler) reply(m_error_handler, what);
+        }
+
+    private:
+        //the asking actor, which may be destroyed before the reply
+        handle<C> m_actor;
+
+        //functions to call
+        handler m_handler;
+        error_handler m_error_handler;
+
+        //puts a reply, if the actor is alive; a reply which cannot be allocated is dropped
+        template <class T> void reply(void (C::*f)(const T &), const T &v) {
+            typename handle<C>::pin p = m_actor.lock();
+            if (!p) return;
+            actor *a = p.get();
+            try {
+                a->put(new (a->m_resource) object_message_1<C, void, T>(p.get(), result<void>(), f, v), PUT_CONTROL);
+            }
+            catch (...) {
+            }
+        }
+    };
+
+    //type message ptr
+    typedef message *message_ptr;
+
+    //an intrusive list of messages; the messages are the nodes,
+    //so putting a message allocates nothing besides the message
+    class message_list {
+    public:
+        //constructor
+        message_list() : m_head(0), m_tail(0) {}
+
+        //checks if the list is empty
+        bool empty() const {
+            return m_head == 0;
+        }
+
+        //returns the first message
+        message_ptr front() const {
+            return m_head;
+        }
+
+        //adds a message to the start
+        void push_front(message_ptr msg) {
+            msg->m_next = m_head;
+            m_head = msg;
+            if (!m_tail) m_tail = msg;
+        }
+
+        //adds a message to the end
+        void push_back(message_ptr msg) {
+            msg->m_next = 0;
+            if (m_tail) m_tail->m_next = msg; else m_head = msg;
+            m_tail = msg;
+        }
+
+        //removes and returns the first message
+        message_ptr pop_front() {
+            message_ptr msg = m_head;
+            m_head = msg->m_next;
+            if (!m_head) m_tail = 0;
+            return msg;
+        }
+
+        //returns the number of messages
+        size_t size() const {
+            size_t n = 0;
+            for (message_ptr msg = m_head; msg; msg = msg->m_next) ++n;
+            return n;
+        }
+
+        //moves all the messages of the given list to the start of this
+        void splice_front(message_list &l) {
+            if (!l.m_head) return;
+            l.m_tail->m_next = m_head;
+            if (!m_head) m_tail = l.m_tail;
+            m_head = l.m_head;
+            l.m_head = l.m_tail = 0;
+        }
+
+        //moves all the messages of the given list to the end of this
+        void splice_back(message_list &l) {
+            if (!l.m_head) return;
+            if (m_tail) m_tail->m_next = l.m_head; else m_head = l.m_head;
+            m_tail = l.m_tail;
+            l.m_head = l.m_tail = 0;
+        }
+
+    private:
+        message_ptr m_head;
+        message_ptr m_tail;
+
+        //not copyable
+        message_list(const message_list &);
+        message_list &operator = (const message_list &);
+    };
+
+    //The members are split in two regions, each in its own cache lines:
+    //the consumer side, used by the actor thread, and the producer side,
+    //written by the threads which put messages. The state of derived
+    //classes, used by the actor thread, follows after another padding.
+
+    //loop flag
+    bool m_loop;
+
+    //number of messages dropped because they expired
+    volatile long m_expired;
+
+    //set when the actor thread has been joined
+    bool m_stopped;
+
+    //set when the loop is terminated after a failure
+    bool m_terminated;
+
+    //supervisor; null if none
+    supervisor *m_supervisor;
+
+    //idle time before hibernation, in nanoseconds; 0 if disabled
+    unsigned long long m_idle_timeout;
+
+    //set when the thread was started by a put to a hibernated actor
+    bool m_rehydrate;
+
+    //the serialized state, while hibernated
+    std::string m_blob;
+
+    //messages taken from the message list, not executed yet;
+    //only the actor thread uses it, without synchronization
+    message_list m_pending;
+
+    //arena for the temporary data of the handlers; reset after each message
+    scratch_arena m_scratch;
+
+    //stashed messages
+    message_list m_stash;
+
+    //set when the current message is stashed
+    bool m_stash_current;
+
+    //set when a batch message is put, so as that messages are merged only then
+    volatile long m_batching;
+
+    //the current behavior; null if none
+    const void *m_behavior;
+
+    //the behaviors kept by become(), ending with the current one
+    std::vector<const void *> m_behaviors;
+
+    //with fair queuing, the queues of the publication slots; null if not enabled
+    message_list *m_sub_queues;
+
+    //ring of the indexes of the non-empty queues, in the order they are served
+    unsigned long *m_active;
+    unsigned long m_active_head;
+    unsigned long m_active_size;
+
+    //turns left before the publication slots are gathered again
+    unsigned long m_turns;
+
+    //number of messages executed from a queue per turn
+    unsigned long m_quantum;
+
+    //padding between the consumer and the producer side
+    char m_pad0[ACTORLIB_CACHE_LINE_SIZE];
+
+    //memory resource; null for the global heap
+    memory_resource *m_resource;
+
+    //index of the slot of the actor in the handle table, and its generation
+    unsigned long m_slot;
+    long m_generation;
+
+    //time to live of the messages, in microseconds; 0 if disabled
+    volatile long m_ttl;
+
+    //target wait for admission control, in microseconds; 0 if disabled
+    volatile long m_max_wait;
+
+    //wait of the last executed message, in microseconds; 0 when the queue is drained
+    volatile long m_wait;
+
+    //number of messages rejected by admission control
+    volatile long m_rejected;
+
+    //throttle; null if none
+    throttle *m_throttle;
+
+    //what to do with messages over the throttle's rate
+    throttle_mode m_throttle_mode;
+
+    //timer for delayed messages
+    timer *m_throttle_timer;
+
+    //number of messages rejected by the throttle
+    volatile long m_throttled;
+
+    //mutex used for synchronization over the message list
+    pthread_mutex_t m_mutex;
+
+    //semaphore posted when the message list becomes non-empty
+    sem_t m_sem;
+
+    //messages
+    message_list m_messages;
+
+    //a slot where threads publish messages, in its own cache line;
+    //it is a stack, of the messages in reverse order
+    struct publication_slot {
+        void *volatile m_head;
+        char m_pad[ACTORLIB_CACHE_LINE_SIZE > sizeof(void *) ? ACTORLIB_CACHE_LINE_SIZE - sizeof(void *) : 1];
+    };
+
+    //the publication slots, aligned to the cache line; null if not enabled
+    publication_slot *m_publication_slots;
+
+    //number of the publication slots
+    unsigned long m_publication_count;
+
+    //the memory of the publication slots
+    char *m_publication_memory;
+
+    //set when the actor thread has been posted to gather the publication slots
+    volatile long m_signalled;
+
+    //set while the actor is terminated, so as that published messages are failed
+    volatile long m_closed;
+
+    //state of the thread, synchronized with the above mutex
+    enum state {
+        RUNNING,
+        HIBERNATING,
+        HIBERNATED,
+        FAILED,
+        STOPPED,
+        DEAD
+    } m_state;
+
+    //mutex held while the thread is joined or created
+    pthread_mutex_t m_thread_mutex;
+
+    //thread handle
+    pthread_t m_thread;
+
+    //padding between the producer side and the members of derived classes
+    char m_pad1[ACTORLIB_CACHE_LINE_SIZE];
+
+    //not copyable
+    actor(const actor &);
+    actor &operator = (const actor &);
+
+    //how a message is put
+    enum put_mode {
+        //at the end of the queue
+        PUT_BACK,
+
+        //at the end of the queue, but never rejected or expired
+        PUT_CONTROL,
+
+        //at the end of the queue, after the throttle delayed it
+        PUT_DELAYED,
+
+        //before the queued messages, never rejected or expired;
+        //it also restarts a terminated actor
+        PUT_FRONT
+    };
+
+    //a timer task which puts a message delayed by the throttle
+    class delayed_put;
+
+    //puts a message in the message queue, synchronized
+    void put(message *msg, put_mode mode = PUT_BACK);
+
+    //applies the throttle to a message; returns false if the message is
+    //rejected or delayed, and so it must not be put now
+    bool apply_throttle(message *msg);
+
+    //puts a control message with 0 parameters
+    void put_control(void (actor::*f)(), put_mode mode = PUT_CONTROL) {
+        put(new (m_resource) object_message_0<actor, void>(this, result<void>(), f), mode);
+    }
+
+    //puts a control message with 1 parameter
+    template <class T1> void put_control(void (actor::*f)(const T1 &), const T1 &t1) {
+        put(new (m_resource) object_message_1<actor, void, T1>(this, result<void>(), f, t1), PUT_CONTROL);
+    }
+
+    //exit
+    void _exit();
+
+    //exit, after the messages published before the exit message
+    void _exit_published();
+
+    //puts a message in the publication slot of the calling thread
+    void publish(message *msg);
+
+    //moves the messages of the publication slots to the end of the given list
+    void gather(message_list &messages);
+
+    //checks if a message is published
+    bool published() const;
+
+    //moves the messages of the publication slots to their queues
+    void gather_sub_queues();
+
+    //moves the messages of the next queue's turn to the pending messages;
+    //returns false if there are none
+    bool next_turn();
+
+    //moves the messages of all the queues to the end of the given list
+    void flush_sub_queues(message_list &messages);
+
+    //sets the supervisor
+    void _set_supervisor(supervisor *const &s);
+
+    //restarts the actor
+    void _restart();
+
+    //terminates the actor, as if it failed
+    void _terminate();
+
+    //handles a message which threw: fails its result, and lets the supervisor decide
+    void failure(message *msg, const std::string &what);
+
+    //puts a restart message before the queued messages, for the supervisor
+    void restart_child();
+
+    //puts a terminate message before the queued messages, for the supervisor
+    void terminate_child();
+
+    //enables hibernation
+    void _enable_hibernation(const unsigned long &idle_ms);
+
+    //the message handling loop
+    void run();
+
+    //waits for messages; returns false if the idle time elapsed
+    bool wait();
+
+    //hibernates the actor if no message arrived; returns true if hibernated
+    bool try_hibernate();
+
+    //starts a new thread for a hibernated or terminated actor
+    void start(bool rehydrate);
+
+    //fails and deletes the messages of the given list
+    static void clear(message_list &messages);
+
+    //internal function which calls the thread's run function
+    static void *thread_proc(void *arg);
+
+    //takes a slot in the handle table
+    void acquire_slot();
+
+    //invalidates the handles, and waits until no handle pins the actor
+    void invalidate_slot();
+
+    //frees the slot, after the handles are invalidated
+    void release_slot();
+
+    //pins the actor of the given slot, if it has the given generation;
+    //returns null if the actor is destroyed
+    static actor *pin(unsigned long slot, long generation);
+
+    //pins again the actor of the given slot, which is pinned already
+    static void repin(unsigned long slot);
+
+    //unpins the actor of the given slot
+    static void unpin(unsigned long slot);
+
+    friend class supervisor;
+    template <class A> friend class handle;
+    template <class Receiver> friend class schedule_operation;
+    template <class K, class V, class Hash> friend class kv_shard;
+    template <class D, class T0, class T1, class T2, class T3, class T4, class T5, class T6, class T7> friend class typed_actor;
+};
+
+
+/** an actor which supervises other actors.
+
+    If a message of a child throws, the result of the message fails with
+    an actor_error, and the child waits for the decision of the supervisor.
+    By default, the children are restarted according to the strategy; if they
+    are restarted too often, they are terminated, and the failure is escalated
+    to the supervisor of the supervisor, if any. A terminated actor fails
+    the results of its queued messages and of any message put to it later.
+
+    The supervisor owns its children, and deletes them in its destructor.
+ */
+class supervisor : public actor {
+public:
+    /** restart strategy.
+        ONE_FOR_ONE restarts only the failed child; ONE_FOR_ALL restarts
+        all the children; REST_FOR_ONE restarts the failed child and
+        the children added after it.
+     */
+    enum strategy {
+        ONE_FOR_ONE,
+        ONE_FOR_ALL,
+        REST_FOR_ONE
+    };
+
+    /** decision about a failed child.
+        RESUME lets the child go on with the next message; RESTART restarts
+        the children according to the strategy; STOP terminates the child;
+        ESCALATE terminates all the children, and fails the supervisor.
+     */
+    enum directive {
+        RESUME,
+        RESTART,
+        STOP,
+        ESCALATE
+    };
+
+    /** the constructor.
+        @param s restart strategy.
+        @param max_restarts maximum number of restarts within the period;
+            one more restart escalates the failure.
+        @param period_ms the period, in milliseconds.
+        @param mr memory resource, as for actor.
+     */
+    supervisor(strategy s = ONE_FOR_ONE, size_t max_restarts = 3, unsigned long period_ms = 5000, memory_resource *mr = 0);
+
+    /** the destructor.
+        The supervisor is stopped, then the children are deleted,
+        in the reverse order they were added.
+     */
+    ~supervisor();
+
+    /** adds a child.
+        The supervisor takes ownership of the child.
+        @param child child to add.
+     */
+    void add(actor *child);
+
+    /** returns the number of restarts.
+        @return the number of restarts.
+     */
+    result<size_t> restart_count() {
+        return put(&supervisor::_restart_count);
+    }
+
+protected:
+    /** decides what to do about a failed child.
+        Invoked in the supervisor thread. The default implementation
+        returns RESTART.
+        @param child the child which failed.
+        @param what description of the failure.
+        @return the decision.
+     */
+    virtual directive decide(actor *child, const std::string &what) {
+        return RESTART;
+    }
+
+    /** restarts all the children.
+        Invoked when the supervisor of the supervisor restarts it.
+     */
+    virtual void restart();
+
+private:
+    //restart strategy
+    strategy m_strategy;
+
+    //maximum number of restarts within the period
+    size_t m_max_restarts;
+
+    //the period, in nanoseconds
+    unsigned long long m_period;
+
+    //times of the restarts within the period
+    std::deque<unsigned long long> m_restarts;
+
+    //number of restarts
+    size_t m_restart_count;
+
+    //children, in the order they were added
+    std::vector<actor *> m_children;
+
+    //adds a child
+    void _add(actor *const &child);
+
+    //returns the number of restarts
+    size_t _restart_count();
+
+    //decides about a failed child, and applies the decision to the other children
+    directive _child_failed(actor *const &child, const std::string &what);
+
+    //puts the failure of a child
+    result<directive> child_failed(actor *child, const std::string &what) {
+        return put(&supervisor::_child_failed, child, what);
+    }
+
+    friend class actor;
+};
+
+
+/** a weak reference to an actor.
+
+    It keeps the index of the actor in a table of slots, and the generation
+    of the slot; destroying the actor increments the generation, so as that
+    the handle no longer resolves, and the slot is recycled for new actors.
+    Resolving a handle takes no lock.
+
+    Value-type class; different copies are thread-safe.
+    @param A type of actor.
+ */
+template <class A> class handle {
+public:
+    /** a strong reference to an actor, obtained from a handle.
+        The actor is not destroyed while a pin exists, so pins
+        should be short-lived: typically, just for a put.
+        Stopping the actor waits for the pins, so a thread
+        must not stop or destroy an actor it pins.
+     */
+    class pin {
+    public:
+        /** the copy constructor.
+            @param p source object.
+         */
+        pin(const pin &p) : m_actor(p.m_actor), m_slot(p.m_slot) {
+            if (m_actor) actor::repin(m_slot);
+        }
+
+        /** the destructor.
+         */
+        ~pin() {
+            if (m_actor) actor::unpin(m_slot);
+        }
+
+        /** returns the actor.
+            @return the actor, or null if it is destroyed.
+         */
+        A *get() const {
+            return m_actor;
+        }
+
+        /** returns the actor.
+            @return the actor.
+         */
+        A *operator -> () const {
+            return m_actor;
+        }
+
+        /** checks if the actor is alive.
+            @return the actor, or null if it is destroyed.
+         */
+        operator A *() const {
+            return m_actor;
+        }
+
+    private:
+        //actor; null if destroyed
+        A *m_actor;
+
+        //slot
+        unsigned long m_slot;
+
+        //constructor
+        pin(A *a, unsigned long slot) : m_actor(a), m_slot(slot) {}
+
+        //not assignable
+        pin &operator = (const pin &);
+
+        friend class handle<A>;
+    };
+
+    /** constructs a null handle.
+     */
+    handle() : m_slot(0), m_generation(0) {}
+
+    /** constructs a handle to the given actor.
+        @param a actor; it must be alive.
+     */
+    handle(A *a) : m_slot(a->m_slot), m_generation(a->m_generation) {}
+
+    /** pins the actor.
+        @return a pin to the actor; null if it is destroyed.
+     */
+    pin lock() const {
+        return pin(static_cast<A *>(actor::pin(m_slot, m_generation)), m_slot);
+    }
+
+    /** checks if the actor is alive.
+        The actor may be destroyed immediately after the call;
+        use lock() for accessing it.
+        @return true if the actor is alive.
+     */
+    bool alive() const {
+        pin p = lock();
+        return p.get() != 0;
+    }
+
+    /** compares two handles.
+        @param h the other handle.
+        @return true if they refer to the same actor.
+     */
+    bool operator == (const handle<A> &h) const {
+        return m_slot == h.m_slot && m_generation == h.m_generation;
+    }
+
+    /** compares two handles.
+        @param h the other handle.
+        @return true if they refer to different actors.
+     */
+    bool operator != (const handle<A> &h) const {
+        return !(*this == h);
+    }
+
+private:
+    //slot
+    unsigned long m_slot;
+
+    //generation of the slot
+    long m_generation;
+};
+
+
+/** a thread which executes tasks after a delay.
+
+    Tasks are executed in the context of the timer thread, so they
+    should be short; usually a task just puts a message to an actor.
+ */
+class timer {
+public:
+    /** a task to execute.
+     */
+    class task {
+    public:
+        /** the destructor.
+         */
+        virtual ~task() {}
+
+        /** executes the task.
+         */
+        virtual void run() = 0;
+    };
+
+    /** task id type.
+     */
+    typedef unsigned long id;
+
+    /** constructs a timer.
+        The internal thread is started.
+     */
+    timer();
+
+    /** destroys the timer.
+        Tasks not yet executed are deleted without being executed.
+     */
+    ~timer();
+
+    /** schedules a task.
+        The timer takes ownership of the task; it is deleted after
+        it is executed or cancelled.
+        @param t task to execute.
+        @param ms delay in milliseconds.
+        @return the id of the task, to be used for cancelling it.
+     */
+    id schedule(task *t, unsigned long ms);
+
+    /** schedules a task at the given time.
+        The timer takes ownership of the task, as above.
+        @param t task to execute.
+        @param ns time to execute the task at, as returned by now_ns().
+        @return the id of the task, to be used for cancelling it.
+     */
+    id schedule_at(task *t, unsigned long long ns);
+
+    /** cancels a task.
+        If the task is currently executing, the calling thread blocks
+        until it is finished.
+        @param i id of the task.
+        @return true if the task was cancelled before it was executed.
+     */
+    bool cancel(id i);
+
+private:
+    //deadline type, in nanoseconds
+    typedef unsigned long long deadline;
+
+    //task queue, ordered by deadline
+    typedef std::multimap<deadline, std::pair<id, task *> > task_queue;
+
+    //index of tasks by id
+    typedef std::map<id, task_queue::iterator> task_index;
+
+    //mutex
+    pthread_mutex_t m_mutex;
+
+    //condition signalled when the queue or the running task changes
+    pthread_cond_t m_cond;
+
+    //thread handle
+    pthread_t m_thread;
+
+    //loop flag
+    bool m_loop;
+
+    //next id
+    id m_next_id;
+
+    //id of the currently executing task, 0 if none
+    id m_running;
+
+    //tasks
+    task_queue m_tasks;
+    task_index m_index;
+
+    //not copyable
+    timer(const timer &);
+    timer &operator = (const timer &);
+
+    //the timer loop
+    void run();
+
+    //internal function which calls the thread's run function
+    static void *thread_proc(void *arg);
+};
+
+
+} //namespace actorlib
+
+
+#endif //ACTORLIB_HPP
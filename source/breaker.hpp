@@ -0,0 +1,241 @@
+#ifndef ACTORLIB_BREAKER_HPP
+#define ACTORLIB_BREAKER_HPP
+
+
+#include "actorlib.hpp"
+
+
+namespace actorlib {
+
+
+/** a circuit breaker around the requests to an actor.
+
+    While it is closed, requests are put, and their results are waited for
+    with a timeout. After a number of consecutive failures or timeouts, it opens:
+    requests fail immediately with an actor_error, without being put, so as
+    that the queue of the target does not build up. After a while, it becomes
+    half-open, and lets a limited number of probe requests through; a probe
+    which succeeds closes it, and one which fails opens it again.
+
+    Thread-safe; it is meant to be shared by all the callers of an actor.
+ */
+class circuit_breaker {
+public:
+    /** state of the breaker.
+     */
+    enum state {
+        CLOSED,
+        OPEN,
+        HALF_OPEN
+    };
+
+    /** statistics of the breaker.
+     */
+    struct stats {
+        //the current state
+        state current;
+
+        //number of requests which succeeded
+        long successes;
+
+        //number of requests which failed
+        long failures;
+
+        //number of requests which timed out
+        long timeouts;
+
+        //number of requests failed immediately, while open
+        long rejected;
+
+        //number of times the breaker opened
+        long opened;
+    };
+
+    /** the constructor.
+        @param failure_threshold number of consecutive failures or timeouts which open the breaker.
+        @param timeout_ms time to wait for a result, in milliseconds.
+        @param open_ms time the breaker stays open before it lets probes through, in milliseconds.
+        @param probes maximum number of probes while half-open.
+     */
+    circuit_breaker(size_t failure_threshold = 5, unsigned long timeout_ms = 1000, unsigned long open_ms = 1000, size_t probes = 1) :
+        m_failure_threshold(failure_threshold),
+        m_timeout(timeout_ms),
+        m_open_time(open_ms * 1000000ULL),
+        m_max_probes(probes),
+        m_state(CLOSED),
+        m_consecutive_failures(0),
+        m_opened_at(0),
+        m_probes(0)
+    {
+        m_stats.current = CLOSED;
+        m_stats.successes = 0;
+        m_stats.failures = 0;
+        m_stats.timeouts = 0;
+        m_stats.rejected = 0;
+        m_stats.opened = 0;
+        pthread_mutex_init(&m_mutex, NULL);
+    }
+
+    /** the destructor.
+     */
+    ~circuit_breaker() {
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    /** checks if a request may be put.
+        If it returns true, the outcome of the request must be reported
+        with success() or failure(), or the request waited for with get().
+        @return true if the request may be put; false if it must fail immediately.
+     */
+    bool allow() {
+        pthread_mutex_lock(&m_mutex);
+        bool allowed = true;
+        if (m_state == OPEN && now_ns() - m_opened_at >= m_open_time) {
+            m_state = HALF_OPEN;
+            m_probes = 0;
+        }
+        if (m_state == OPEN || (m_state == HALF_OPEN && m_probes >= m_max_probes)) {
+            ++m_stats.rejected;
+            allowed = false;
+        }
+        else if (m_state == HALF_OPEN) {
+            ++m_probes;
+        }
+        pthread_mutex_unlock(&m_mutex);
+        return allowed;
+    }
+
+    /** reports a request which succeeded.
+     */
+    void success() {
+        pthread_mutex_lock(&m_mutex);
+        ++m_stats.successes;
+        m_consecutive_failures = 0;
+        if (m_state == HALF_OPEN) m_state = CLOSED;
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    /** reports a request which failed.
+        @param timeout true if the request timed out.
+     */
+    void failure(bool timeout = false) {
+        pthread_mutex_lock(&m_mutex);
+        if (timeout) ++m_stats.timeouts; else ++m_stats.failures;
+        if (m_state == HALF_OPEN || (m_state == CLOSED && ++m_consecutive_failures >= m_failure_threshold)) {
+            m_state = OPEN;
+            m_opened_at = now_ns();
+            m_consecutive_failures = 0;
+            ++m_stats.opened;
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    /** waits for the result of a request, and reports its outcome.
+        @param r result of the request.
+        @return the value of the result.
+        @exception actor_error thrown if the request failed or timed out.
+     */
+    template <class R> R get(const result<R> &r) {
+        if (!r.wait_for(m_timeout)) {
+            failure(true);
+            throw actor_error("request timed out");
+        }
+        try {
+            const R &v = r.value();
+            success();
+            return v;
+        }
+        catch (const actor_error &) {
+            failure();
+            throw;
+        }
+    }
+
+    /** puts a request with 0 parameters through the breaker, and waits for its result.
+        @param a target actor.
+        @param f public function of the actor which puts the request.
+        @return the value of the result.
+        @exception actor_error thrown if the breaker is open, or the request failed or timed out.
+     */
+    template <class A, class R> R call(A *a, result<R> (A::*f)()) {
+        if (!allow()) throw actor_error("circuit open");
+        return get((a->*f)());
+    }
+
+    /** puts a request with 1 parameter through the breaker, and waits for its result.
+        @param a target actor.
+        @param f public function of the actor which puts the request.
+        @param t1 1st argument.
+        @return the value of the result.
+        @exception actor_error thrown if the breaker is open, or the request failed or timed out.
+     */
+    template <class A, class R, class P1, class T1> R call(A *a, result<R> (A::*f)(P1), const T1 &t1) {
+        if (!allow()) throw actor_error("circuit open");
+        return get((a->*f)(t1));
+    }
+
+    /** puts a request with 2 parameters through the breaker, and waits for its result.
+        @param a target actor.
+        @param f public function of the actor which puts the request.
+        @param t1 1st argument.
+        @param t2 2nd argument.
+        @return the value of the result.
+        @exception actor_error thrown if the breaker is open, or the request failed or timed out.
+     */
+    template <class A, class R, class P1, class P2, class T1, class T2> R call(A *a, result<R> (A::*f)(P1, P2), const T1 &t1, const T2 &t2) {
+        if (!allow()) throw actor_error("circuit open");
+        return get((a->*f)(t1, t2));
+    }
+
+    /** returns the statistics.
+        @return the statistics.
+     */
+    stats statistics() {
+        pthread_mutex_lock(&m_mutex);
+        stats s = m_stats;
+        s.current = m_state;
+        pthread_mutex_unlock(&m_mutex);
+        return s;
+    }
+
+private:
+    //number of consecutive failures which open the breaker
+    size_t m_failure_threshold;
+
+    //time to wait for a result, in milliseconds
+    unsigned long m_timeout;
+
+    //time the breaker stays open, in nanoseconds
+    unsigned long long m_open_time;
+
+    //maximum number of probes while half-open
+    size_t m_max_probes;
+
+    //mutex
+    pthread_mutex_t m_mutex;
+
+    //state
+    state m_state;
+
+    //number of consecutive failures while closed
+    size_t m_consecutive_failures;
+
+    //time the breaker opened
+    unsigned long long m_opened_at;
+
+    //number of probes let through while half-open
+    size_t m_probes;
+
+    //statistics
+    stats m_stats;
+
+    //not copyable
+    circuit_breaker(const circuit_breaker &);
+    circuit_breaker &operator = (const circuit_breaker &);
+};
+
+
+} //namespace actorlib
+
+
+#endif //ACTORLIB_BREAKER_HPP
@@ -0,0 +1,352 @@
+#ifndef ACTORLIB_CACHE_HPP
+#define ACTORLIB_CACHE_HPP
+
+
+#include <map>
+#include <vector>
+#include "parallel.hpp"
+#include "kvstore.hpp"
+
+
+namespace actorlib {
+
+
+/** the default cost function of a cache; each entry costs 1,
+    so the budget of the cache is a number of entries.
+ */
+template <class K, class V> struct cache_unit_cost {
+    /** returns the cost of an entry.
+        @return the cost.
+     */
+    size_t operator ()(const K &, const V &) const {
+        return 1;
+    }
+};
+
+
+/** cache statistics.
+ */
+struct cache_stats {
+    //requests served from the cache
+    unsigned long hits;
+
+    //requests which were not in the cache
+    unsigned long misses;
+
+    //misses which joined a load already in flight
+    unsigned long coalesced;
+
+    //loads started
+    unsigned long loads;
+
+    //entries removed to stay within the budget
+    unsigned long evictions;
+
+    //entries removed because their time-to-live elapsed
+    unsigned long expirations;
+
+    //current number of entries
+    size_t entries;
+
+    //current cost of the entries
+    size_t cost;
+
+    /** the constructor.
+     */
+    cache_stats() :
+        hits(0), misses(0), coalesced(0), loads(0),
+        evictions(0), expirations(0), entries(0), cost(0) {}
+};
+
+
+/** a read-through cache actor.
+
+    On a miss, the value is computed by a loader, in a worker of a group,
+    so as that the cache keeps serving requests while the load is in flight.
+    Concurrent requests for a key which is being loaded wait for the same load,
+    so the loader is invoked once per key, no matter how many ask for it.
+
+    The cost of the entries is bounded by a budget; when it is exceeded,
+    entries are evicted with the CLOCK policy, an approximation of LRU
+    which costs one flag write per hit. Entries may also expire after
+    a time-to-live.
+
+    @param K type of key; it must be less-than comparable and hashable.
+    @param V type of value.
+    @param Loader function object type; it is invoked as V loader(const K &),
+        concurrently from the workers.
+    @param Hash hash function type.
+    @param Cost cost function type; it is invoked as size_t cost(const K &, const V &).
+ */
+template <class K, class V, class Loader, class Hash = kv_hash<K>, class Cost = cache_unit_cost<K, V> >
+class cache : public actor {
+public:
+    /** the constructor.
+        @param workers workers to run the loader in.
+        @param loader loader.
+        @param budget maximum total cost of the entries.
+        @param ttl time-to-live of entries, in milliseconds; 0 for no expiry.
+     */
+    cache(worker_group &workers, const Loader &loader, size_t budget, unsigned long ttl = 0) :
+        m_workers(&workers), m_next_worker(0), m_loader(loader), m_budget(budget),
+        m_ttl((unsigned long long)ttl * 1000000ULL), m_hand(0), m_loads(0)
+    {
+        pthread_mutex_init(&m_loads_mutex, NULL);
+        pthread_cond_init(&m_loads_cond, NULL);
+    }
+
+    /** the destructor.
+        The cache is stopped first, so as that the requests already queued
+        are served, and no load starts after; then it waits for the loads
+        in flight to finish, and fails the requests still waiting for them.
+     */
+    ~cache() {
+        stop();
+        pthread_mutex_lock(&m_loads_mutex);
+        while (m_loads > 0) pthread_cond_wait(&m_loads_cond, &m_loads_mutex);
+        pthread_mutex_unlock(&m_loads_mutex);
+        for (typename std::map<K, waiters>::iterator it = m_pending.begin(); it != m_pending.end(); ++it) {
+            for (size_t i = 0; i < it->second.size(); ++i) {
+                it->second[i].fail("actor terminated");
+            }
+        }
+        pthread_cond_destroy(&m_loads_cond);
+        pthread_mutex_destroy(&m_loads_mutex);
+    }
+
+    /** gets a value.
+        @param k key.
+        @return the value.
+     */
+    result<V> get(const K &k) {
+        result<V> r;
+        put(&cache::_get, k, r);
+        return r;
+    }
+
+    /** removes a key from the cache.
+        A load in flight for the key is not affected.
+        @param k key.
+     */
+    void invalidate(const K &k) {
+        put(&cache::_invalidate, k);
+    }
+
+    /** returns the statistics of the cache.
+        @return the statistics.
+     */
+    result<cache_stats> stats() {
+        return put(&cache::_stats);
+    }
+
+private:
+    //an entry
+    struct entry {
+        K m_key;
+        V m_value;
+        unsigned long long m_expiry;
+        size_t m_cost;
+        bool m_used;
+        bool m_referenced;
+
+        entry() : m_expiry(0), m_cost(0), m_used(false), m_referenced(false) {}
+    };
+
+    //results waiting for a load
+    typedef std::vector<result<V> > waiters;
+
+    //the task which loads a value in a worker;
+    //if the loader throws, the waiting results fail
+    class load_task : public worker::task {
+    public:
+        load_task(cache *c, const K &k) : m_cache(c), m_key(k) {}
+
+        virtual void run() {
+            done d(m_cache);
+            try {
+                V v = m_cache->m_loader(m_key);
+                m_cache->put(&cache::_loaded, m_key, v);
+            }
+            catch (const std::exception &ex) {
+                m_cache->put(&cache::_load_failed, m_key, std::string(ex.what()));
+            }
+            catch (...) {
+                m_cache->put(&cache::_load_failed, m_key, std::string("unknown exception"));
+            }
+        }
+
+    private:
+        //calls load_done() when the task no longer uses the cache, on every path
+        struct done {
+            cache *m_cache;
+            done(cache *c) : m_cache(c) {}
+            ~done() { m_cache->load_done(); }
+        };
+
+        cache *m_cache;
+        K m_key;
+    };
+
+    //loading
+    worker_group *m_workers;
+    size_t m_next_worker;
+    Loader m_loader;
+    std::map<K, waiters> m_pending;
+
+    //entries, with an index by key and a list of free entries
+    std::vector<entry> m_entries;
+    kv_table<K, size_t, Hash> m_index;
+    std::vector<size_t> m_free;
+
+    //budget
+    Cost m_cost;
+    size_t m_budget;
+    unsigned long long m_ttl;
+
+    //clock hand
+    size_t m_hand;
+
+    //statistics
+    cache_stats m_stats;
+
+    //loads in flight, waited for by the destructor
+    pthread_mutex_t m_loads_mutex;
+    pthread_cond_t m_loads_cond;
+    size_t m_loads;
+
+    //called by a load task when it no longer uses the cache
+    void load_done() {
+        pthread_mutex_lock(&m_loads_mutex);
+        if (--m_loads == 0) pthread_cond_broadcast(&m_loads_cond);
+        pthread_mutex_unlock(&m_loads_mutex);
+    }
+
+    //internal get
+    void _get(const K &k, const result<V> &r) {
+        size_t i;
+        if (m_index.find(k, i)) {
+            entry &e = m_entries[i];
+            if (m_ttl == 0 || now_ns() < e.m_expiry) {
+                ++m_stats.hits;
+                e.m_referenced = true;
+                result<V>(r).set(e.m_value);
+                return;
+            }
+            ++m_stats.expirations;
+            remove(i);
+        }
+
+        ++m_stats.misses;
+
+        //join the load in flight, if any
+        typename std::map<K, waiters>::iterator it = m_pending.find(k);
+        if (it != m_pending.end()) {
+            ++m_stats.coalesced;
+            it->second.push_back(r);
+            return;
+        }
+
+        //start a load
+        m_pending[k].push_back(r);
+        ++m_stats.loads;
+        pthread_mutex_lock(&m_loads_mutex);
+        ++m_loads;
+        pthread_mutex_unlock(&m_loads_mutex);
+        (*m_workers)[m_next_worker].exec(new load_task(this, k));
+        m_next_worker = (m_next_worker + 1) % m_workers->size();
+    }
+
+    //internal completion of a load
+    void _loaded(const K &k, const V &v) {
+        typename std::map<K, waiters>::iterator it = m_pending.find(k);
+        if (it != m_pending.end()) {
+            for (size_t i = 0; i < it->second.size(); ++i) {
+                it->second[i].set(v);
+            }
+            m_pending.erase(it);
+        }
+        insert(k, v);
+    }
+
+    //internal failure of a load; a later get of the key starts a new load
+    void _load_failed(const K &k, const std::string &what) {
+        typename std::map<K, waiters>::iterator it = m_pending.find(k);
+        if (it == m_pending.end()) return;
+        for (size_t i = 0; i < it->second.size(); ++i) {
+            it->second[i].fail(what);
+        }
+        m_pending.erase(it);
+    }
+
+    //internal invalidate
+    void _invalidate(const K &k) {
+        size_t i;
+        if (m_index.find(k, i)) remove(i);
+    }
+
+    //internal stats
+    cache_stats _stats() {
+        return m_stats;
+    }
+
+    //inserts an entry, evicting others if needed
+    void insert(const K &k, const V &v) {
+        size_t cost = m_cost(k, v);
+        if (cost > m_budget) return;
+        size_t i;
+        if (m_index.find(k, i)) remove(i);
+        while (m_stats.cost + cost > m_budget) evict();
+        if (m_free.empty()) {
+            i = m_entries.size();
+            m_entries.push_back(entry());
+        }
+        else {
+            i = m_free.back();
+            m_free.pop_back();
+        }
+        entry &e = m_entries[i];
+        e.m_key = k;
+        e.m_value = v;
+        e.m_expiry = m_ttl ? now_ns() + m_ttl : 0;
+        e.m_cost = cost;
+        e.m_used = true;
+        e.m_referenced = false;
+        m_index.set(k, i);
+        ++m_stats.entries;
+        m_stats.cost += cost;
+    }
+
+    //evicts one entry: the first one found by the clock hand which
+    //has not been referenced since the hand last passed over it
+    void evict() {
+        for (;;) {
+            entry &e = m_entries[m_hand];
+            size_t i = m_hand;
+            m_hand = (m_hand + 1) % m_entries.size();
+            if (!e.m_used) continue;
+            if (e.m_referenced) {
+                e.m_referenced = false;
+                continue;
+            }
+            ++m_stats.evictions;
+            remove(i);
+            return;
+        }
+    }
+
+    //removes an entry
+    void remove(size_t i) {
+        entry &e = m_entries[i];
+        m_index.erase(e.m_key);
+        m_stats.cost -= e.m_cost;
+        --m_stats.entries;
+        e = entry();
+        m_free.push_back(i);
+    }
+};
+
+
+} //namespace actorlib
+
+
+#endif //ACTORLIB_CACHE_HPP
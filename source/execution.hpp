@@ -0,0 +1,349 @@
+#ifndef ACTORLIB_EXECUTION_HPP
+#define ACTORLIB_EXECUTION_HPP
+
+
+#include "actorlib.hpp"
+
+
+#if ACTORLIB_HAS_MOVE
+
+
+#include <exception>
+#include <type_traits>
+#ifdef __has_include
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+
+
+/** defined as 1 if the standard library has std::execution (P2300);
+    the senders and the scheduler then declare the concepts they model,
+    and their completion signatures, for the standard algorithms.
+    Without it, they can be connected to any receiver which has the
+    member functions set_value() and set_error(std::exception_ptr).
+ */
+#ifndef ACTORLIB_HAS_STD_EXECUTION
+#ifdef __cpp_lib_senders
+#define ACTORLIB_HAS_STD_EXECUTION 1
+#else
+#define ACTORLIB_HAS_STD_EXECUTION 0
+#endif
+#endif
+
+
+#if ACTORLIB_HAS_STD_EXECUTION
+#include <execution>
+#endif
+
+
+namespace actorlib {
+
+
+/** the operation of a sender returned by schedule().
+    When started, it puts a message to the actor, which completes
+    the receiver with set_value() in the actor thread, after the messages
+    already queued; if the message is rejected, expires, or the actor is
+    terminated, it completes the receiver with set_error().
+    The message is kept in the operation, so starting it allocates nothing.
+    @param Receiver type of receiver.
+ */
+template <class Receiver> class schedule_operation {
+public:
+    /** the constructor.
+        @param a actor.
+        @param r receiver.
+     */
+    template <class R> schedule_operation(actor *a, R &&r) :
+        m_actor(a), m_receiver(std::forward<R>(r)), m_message(this) {}
+
+    /** the move constructor; the operation must not be started.
+        @param op operation.
+     */
+    schedule_operation(schedule_operation &&op) :
+        m_actor(op.m_actor), m_receiver(std::move(op.m_receiver)), m_message(this) {}
+
+    /** puts the message to the actor.
+     */
+    void start() noexcept {
+        m_actor->put(&m_message);
+    }
+
+private:
+    //the message put to the actor
+    class message : public actor::message {
+    public:
+        //constructor
+        explicit message(schedule_operation *op) : m_operation(op), m_executed(false) {}
+
+        //marks the message executed; the receiver is completed when the actor releases it
+        virtual void exec() {
+            m_executed = true;
+        }
+
+        //keeps the description of the failure
+        virtual void fail(const std::string &what) {
+            m_error = what;
+        }
+
+        //completes the receiver, which may destroy the operation
+        virtual void release() {
+            m_operation->complete();
+        }
+
+        schedule_operation *m_operation;
+        bool m_executed;
+        std::string m_error;
+    };
+
+    actor *m_actor;
+    Receiver m_receiver;
+    message m_message;
+
+    //completes the receiver, with the value if the message was executed
+    void complete() {
+        if (m_message.m_executed) {
+            std::move(m_receiver).set_value();
+        }
+        else {
+            std::exception_ptr e = std::make_exception_ptr(actor_error(m_message.m_error));
+            std::move(m_receiver).set_error(e);
+        }
+    }
+
+    //not copyable
+    schedule_operation(const schedule_operation &);
+    schedule_operation &operator = (const schedule_operation &);
+};
+
+
+class schedule_sender;
+
+
+/** a scheduler which executes work in the context of an actor.
+    The work runs in the actor thread, between its messages, so it is
+    serialized with them.
+ */
+class actor_scheduler {
+public:
+#if ACTORLIB_HAS_STD_EXECUTION
+    typedef std::execution::scheduler_t scheduler_concept;
+#endif
+
+    /** the constructor.
+        @param a actor; it must outlive the scheduler and its senders.
+     */
+    actor_scheduler(actor &a) : m_actor(&a) {}
+
+    /** returns a sender which completes in the actor thread.
+        @return the sender.
+     */
+    schedule_sender schedule() const noexcept;
+
+    /** compares schedulers; they are equal if they have the same actor.
+        @param s the other scheduler.
+        @return true if equal.
+     */
+    bool operator == (const actor_scheduler &s) const noexcept {
+        return m_actor == s.m_actor;
+    }
+
+    /** compares schedulers; they are equal if they have the same actor.
+        @param s the other scheduler.
+        @return true if different.
+     */
+    bool operator != (const actor_scheduler &s) const noexcept {
+        return m_actor != s.m_actor;
+    }
+
+private:
+    actor *m_actor;
+};
+
+
+/** the sender returned by schedule().
+ */
+class schedule_sender {
+public:
+#if ACTORLIB_HAS_STD_EXECUTION
+    typedef std::execution::sender_t sender_concept;
+
+    typedef std::execution::completion_signatures<
+        std::execution::set_value_t(),
+        std::execution::set_error_t(std::exception_ptr)> completion_signatures;
+
+    /** the environment of the sender, which gives its completion scheduler.
+     */
+    class env {
+    public:
+        /** the constructor.
+            @param a actor.
+         */
+        explicit env(actor *a) : m_actor(a) {}
+
+        /** returns the scheduler of the actor.
+            @return the scheduler.
+         */
+        template <class Tag> actor_scheduler query(std::execution::get_completion_scheduler_t<Tag>) const noexcept {
+            return actor_scheduler(*m_actor);
+        }
+
+    private:
+        actor *m_actor;
+    };
+
+    /** returns the environment of the sender.
+        @return the environment.
+     */
+    env get_env() const noexcept {
+        return env(m_actor);
+    }
+#endif
+
+    /** the constructor.
+        @param a actor.
+     */
+    explicit schedule_sender(actor *a) : m_actor(a) {}
+
+    /** connects the sender to a receiver.
+        @param r receiver.
+        @return the operation.
+     */
+    template <class Receiver> schedule_operation<typename std::decay<Receiver>::type> connect(Receiver &&r) const {
+        return schedule_operation<typename std::decay<Receiver>::type>(m_actor, std::forward<Receiver>(r));
+    }
+
+private:
+    actor *m_actor;
+};
+
+
+//returns a sender which completes in the actor thread
+inline schedule_sender actor_scheduler::schedule() const noexcept {
+    return schedule_sender(m_actor);
+}
+
+
+/** returns a sender which completes in the actor thread.
+    An actor converts to its scheduler, so it can be invoked as schedule(a).
+    @param s scheduler.
+    @return the sender.
+ */
+inline schedule_sender schedule(const actor_scheduler &s) {
+    return s.schedule();
+}
+
+
+/** the operation of a sender returned by as_sender().
+    When started, it adds a continuation to the result, so as that the
+    receiver is completed by the thread which sets or fails the result,
+    or at once, if the result is already set or failed; it never blocks.
+    @param R type of result.
+    @param Receiver type of receiver.
+ */
+template <class R, class Receiver> class result_operation {
+public:
+    /** the constructor.
+        @param r result.
+        @param rc receiver.
+     */
+    template <class Rc> result_operation(const result<R> &r, Rc &&rc) :
+        m_result(r), m_receiver(std::forward<Rc>(rc)) {}
+
+    /** the move constructor; the operation must not be started.
+        @param op operation.
+     */
+    result_operation(result_operation &&op) :
+        m_result(op.m_result), m_receiver(std::move(op.m_receiver)) {}
+
+    /** adds the continuation to the result.
+     */
+    void start() noexcept {
+        continuation *c = new (std::nothrow) continuation(this);
+        if (!c) {
+            std::exception_ptr e = std::make_exception_ptr(std::bad_alloc());
+            std::move(m_receiver).set_error(e);
+            return;
+        }
+        m_result.then(c);
+    }
+
+private:
+    //the continuation which completes the receiver
+    class continuation : public result<R>::continuation {
+    public:
+        //constructor
+        explicit continuation(result_operation *op) : m_operation(op) {}
+
+        //completes the receiver with the value
+        virtual void set(const R &v) {
+            std::move(m_operation->m_receiver).set_value(v);
+        }
+
+        //completes the receiver with the failure
+        virtual void fail(const std::string &what) {
+            std::exception_ptr e = std::make_exception_ptr(actor_error(what));
+            std::move(m_operation->m_receiver).set_error(e);
+        }
+
+    private:
+        result_operation *m_operation;
+    };
+
+    result<R> m_result;
+    Receiver m_receiver;
+
+    //not copyable
+    result_operation(const result_operation &);
+    result_operation &operator = (const result_operation &);
+};
+
+
+/** a sender which completes with the value of a result, or its failure.
+    @param R type of result; not void.
+ */
+template <class R> class result_sender {
+public:
+#if ACTORLIB_HAS_STD_EXECUTION
+    typedef std::execution::sender_t sender_concept;
+
+    typedef std::execution::completion_signatures<
+        std::execution::set_value_t(R),
+        std::execution::set_error_t(std::exception_ptr)> completion_signatures;
+#endif
+
+    /** the constructor.
+        @param r result.
+     */
+    explicit result_sender(const result<R> &r) : m_result(r) {}
+
+    /** connects the sender to a receiver.
+        @param r receiver.
+        @return the operation.
+     */
+    template <class Receiver> result_operation<R, typename std::decay<Receiver>::type> connect(Receiver &&r) const {
+        return result_operation<R, typename std::decay<Receiver>::type>(m_result, std::forward<Receiver>(r));
+    }
+
+private:
+    result<R> m_result;
+};
+
+
+/** adapts a result to a sender, which completes with its value, or
+    with an actor_error if it fails, without blocking a thread.
+    @param r result.
+    @return the sender.
+ */
+template <class R> result_sender<R> as_sender(const result<R> &r) {
+    return result_sender<R>(r);
+}
+
+
+} //namespace actorlib
+
+
+#endif //ACTORLIB_HAS_MOVE
+
+
+#endif //ACTORLIB_EXECUTION_HPP
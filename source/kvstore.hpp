@@ -0,0 +1,706 @@
+#ifndef ACTORLIB_KVSTORE_HPP
+#define ACTORLIB_KVSTORE_HPP
+
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <unistd.h>
+#include "actorlib.hpp"
+
+
+namespace actorlib {
+
+
+//mixes the bits of a 64-bit value
+inline size_t kv_mix(unsigned long long x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (size_t)x;
+}
+
+
+/** the default hash function of the key-value store.
+    The generic version is for integral keys.
+    @param K type of key.
+ */
+template <class K> struct kv_hash {
+    /** returns the hash of a key.
+        @param k key.
+        @return the hash.
+     */
+    size_t operator ()(const K &k) const {
+        return kv_mix((unsigned long long)k);
+    }
+};
+
+
+/** hash function for string keys (FNV-1a).
+ */
+template <> struct kv_hash<std::string> {
+    /** returns the hash of a key.
+        @param k key.
+        @return the hash.
+     */
+    size_t operator ()(const std::string &k) const {
+        unsigned long long h = 14695981039346656037ULL;
+        for (std::string::size_type i = 0; i < k.size(); ++i) {
+            h = (h ^ (unsigned char)k[i]) * 1099511628211ULL;
+        }
+        return kv_mix(h);
+    }
+};
+
+
+/** an open addressing hash table with linear probing.
+
+    Each slot has a one-byte tag, kept in an array separate from the keys
+    and the values; a probe sequence scans the tags, which are 64 per
+    cache line, and compares a key only when its tag matches.
+
+    Value-type class; not thread-safe.
+    @param K type of key.
+    @param V type of value.
+    @param Hash hash function type.
+ */
+template <class K, class V, class Hash = kv_hash<K> > class kv_table {
+public:
+    /** the constructor.
+        @param capacity initial capacity; rounded up to a power of 2.
+     */
+    kv_table(size_t capacity = 16) : m_size(0), m_used(0) {
+        size_t n = 16;
+        while (n < capacity) n *= 2;
+        m_tags.resize(n, EMPTY);
+        m_keys.resize(n);
+        m_values.resize(n);
+        m_mask = n - 1;
+    }
+
+    /** returns the number of entries.
+        @return the number of entries.
+     */
+    size_t size() const {
+        return m_size;
+    }
+
+    /** finds a value.
+        @param k key.
+        @param v variable to copy the value to, if found.
+        @return true if found.
+     */
+    bool find(const K &k, V &v) const {
+        size_t i = find_slot(k, m_hash(k));
+        if (i == NPOS) return false;
+        v = m_values[i];
+        return true;
+    }
+
+    /** sets the value of a key.
+        @param k key.
+        @param v value.
+     */
+    void set(const K &k, const V &v) {
+        size_t h = m_hash(k);
+        size_t i = find_slot(k, h);
+        if (i != NPOS) {
+            m_values[i] = v;
+            return;
+        }
+        if ((m_used + 1) * 8 > m_tags.size() * 7) {
+            rehash(m_size * 2 >= m_tags.size() ? m_tags.size() * 2 : m_tags.size());
+        }
+        i = h & m_mask;
+        while (m_tags[i] & FULL) i = (i + 1) & m_mask;
+        if (m_tags[i] == EMPTY) ++m_used;
+        m_tags[i] = tag(h);
+        m_keys[i] = k;
+        m_values[i] = v;
+        ++m_size;
+    }
+
+    /** removes a key.
+        @param k key.
+        @return true if the key was found.
+     */
+    bool erase(const K &k) {
+        size_t i = find_slot(k, m_hash(k));
+        if (i == NPOS) return false;
+        m_tags[i] = DELETED;
+        m_keys[i] = K();
+        m_values[i] = V();
+        --m_size;
+        return true;
+    }
+
+private:
+    //tag values; a full slot has the high bit set, and 7 bits of the hash
+    enum {
+        EMPTY = 0,
+        DELETED = 1,
+        FULL = 0x80
+    };
+
+    //not found index
+    static const size_t NPOS = (size_t)-1;
+
+    //members
+    std::vector<unsigned char> m_tags;
+    std::vector<K> m_keys;
+    std::vector<V> m_values;
+    size_t m_size;
+    size_t m_used;
+    size_t m_mask;
+    Hash m_hash;
+
+    //returns the tag of a hash; the top bits, since the low ones are the index
+    static unsigned char tag(size_t h) {
+        return (unsigned char)(FULL | (h >> (sizeof(size_t) * 8 - 7)));
+    }
+
+    //returns the slot of a key, or NPOS
+    size_t find_slot(const K &k, size_t h) const {
+        unsigned char t = tag(h);
+        for (size_t i = h & m_mask; m_tags[i] != EMPTY; i = (i + 1) & m_mask) {
+            if (m_tags[i] == t && m_keys[i] == k) return i;
+        }
+        return NPOS;
+    }
+
+    //rebuilds the table with the given capacity, dropping the deleted slots
+    void rehash(size_t n) {
+        kv_table<K, V, Hash> t(n);
+        for (size_t i = 0; i < m_tags.size(); ++i) {
+            if (m_tags[i] & FULL) t.set(m_keys[i], m_values[i]);
+        }
+        m_tags.swap(t.m_tags);
+        m_keys.swap(t.m_keys);
+        m_values.swap(t.m_values);
+        m_used = m_size;
+        m_mask = t.m_mask;
+    }
+};
+
+
+//a reference-counted table, shared between a shard and its snapshots.
+//While it is shared, it is not modified; the shard copies it before writing.
+template <class K, class V, class Hash> class kv_shared_table {
+public:
+    //the table
+    kv_table<K, V, Hash> m_table;
+
+    //constructors
+    kv_shared_table() : m_ref_count(1) {}
+
+    kv_shared_table(const kv_table<K, V, Hash> &t) : m_table(t), m_ref_count(1) {}
+
+    //increment the reference count
+    void inc_ref() {
+        atomic_increment(&m_ref_count);
+    }
+
+    //decrements the reference count and deletes the object if it reaches 0
+    void dec_ref() {
+        if (atomic_decrement(&m_ref_count) == 0) delete this;
+    }
+
+    //checks if there are other references
+    bool shared() {
+        return atomic_load(&m_ref_count) > 1;
+    }
+
+private:
+    volatile long m_ref_count;
+};
+
+
+//returns the shard of a hash; uses the top bits, since the tables use the low ones
+inline size_t kv_route(size_t h, size_t shards) {
+    return (h >> (sizeof(size_t) * 4)) % shards;
+}
+
+
+//the shared output of a multi-get; the last shard to finish sets the result,
+//or fails it if the request of a shard failed
+template <class V> class kv_gather {
+public:
+    //type of values
+    typedef std::vector<std::pair<bool, V> > values;
+
+    //values, in the order of the keys
+    values m_values;
+
+    //constructor
+    kv_gather(size_t n, size_t shards, const result<values> &r) :
+        m_values(n), m_remaining(shards), m_failed(false), m_result(r)
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+    }
+
+    //destructor
+    ~kv_gather() {
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    //called by a shard whose request failed, before done()
+    void fail(const std::string &what) {
+        pthread_mutex_lock(&m_mutex);
+        if (!m_failed) m_error = what;
+        m_failed = true;
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    //called by each shard when done
+    void done() {
+        pthread_mutex_lock(&m_mutex);
+        bool last = --m_remaining == 0;
+        pthread_mutex_unlock(&m_mutex);
+        if (last) {
+            if (m_failed) m_result.fail(m_error); else m_result.set(m_values);
+            delete this;
+        }
+    }
+
+private:
+    pthread_mutex_t m_mutex;
+    size_t m_remaining;
+    bool m_failed;
+    std::string m_error;
+    result<values> m_result;
+};
+
+
+//the part of a multi-get which goes to one shard
+template <class K, class V> struct kv_get_request {
+    //the shared output
+    kv_gather<V> *m_gather;
+
+    //keys of the shard, and their positions in the output
+    std::vector<K> m_keys;
+    std::vector<size_t> m_positions;
+};
+
+
+/** a shard of the key-value store.
+    It is an actor which owns one hash table.
+    @param K type of key.
+    @param V type of value.
+    @param Hash hash function type.
+ */
+template <class K, class V, class Hash = kv_hash<K> > class kv_shard : public actor {
+public:
+    //type of the shared table
+    typedef kv_shared_table<K, V, Hash> shared_table;
+
+    //type of a multi-set
+    typedef std::vector<std::pair<K, V> > items;
+
+    /** the constructor.
+     */
+    kv_shard() : m_table(new shared_table) {}
+
+    /** the destructor.
+     */
+    ~kv_shard() {
+        stop();
+        m_table->dec_ref();
+    }
+
+    /** gets a value.
+        @param k key.
+        @return a pair of a found flag and the value.
+     */
+    result<std::pair<bool, V> > get(const K &k) {
+        return put(&kv_shard::_get, k);
+    }
+
+    /** sets a value.
+        @param k key.
+        @param v value.
+     */
+    void set(const K &k, const V &v) {
+        put(&kv_shard::_set, k, v);
+    }
+
+    /** removes a key.
+        @param k key.
+        @return true if the key was found.
+     */
+    result<bool> erase(const K &k) {
+        return put(&kv_shard::_erase, k);
+    }
+
+    /** gets many values.
+        The shard takes ownership of the request, and completes its gather
+        even if the request is not executed.
+        @param r request.
+     */
+    void multi_get(kv_get_request<K, V> *r) {
+        put(new (m_resource) get_message(this, r));
+    }
+
+    /** sets many values.
+        The shard takes ownership of the items.
+        @param i items.
+     */
+    void multi_set(items *i) {
+        put(new (m_resource) set_message(this, i));
+    }
+
+    /** stops the shard, after the requests already queued;
+        the requests put after fail. It must be called by the thread
+        which destroys the shard.
+     */
+    void stop() {
+        actor::stop();
+    }
+
+    /** returns the current table, for a snapshot.
+        The caller must release the table with dec_ref().
+        @return the table.
+     */
+    result<shared_table *> snapshot() {
+        return put(&kv_shard::_snapshot);
+    }
+
+private:
+    //the message of a multi-get; it frees the request and completes the
+    //gather when released, so as that a failed request does not hang it
+    class get_message : public message {
+    public:
+        get_message(kv_shard *s, kv_get_request<K, V> *r) : m_shard(s), m_request(r) {}
+
+        virtual void exec() {
+            m_shard->_multi_get(*m_request);
+        }
+
+        virtual void fail(const std::string &what) {
+            m_request->m_gather->fail(what);
+        }
+
+        virtual void release() {
+            m_request->m_gather->done();
+            delete m_request;
+            delete this;
+        }
+
+    private:
+        kv_shard *m_shard;
+        kv_get_request<K, V> *m_request;
+    };
+
+    //the message of a multi-set; it frees the items when released
+    class set_message : public message {
+    public:
+        set_message(kv_shard *s, items *i) : m_shard(s), m_items(i) {}
+
+        virtual void exec() {
+            m_shard->_multi_set(*m_items);
+        }
+
+        virtual void release() {
+            delete m_items;
+            delete this;
+        }
+
+    private:
+        kv_shard *m_shard;
+        items *m_items;
+    };
+
+    //the table
+    shared_table *m_table;
+
+    //copies the table if a snapshot uses it
+    kv_table<K, V, Hash> &writable_table() {
+        if (m_table->shared()) {
+            shared_table *t = new shared_table(m_table->m_table);
+            m_table->dec_ref();
+            m_table = t;
+        }
+        return m_table->m_table;
+    }
+
+    //internal get
+    std::pair<bool, V> _get(const K &k) {
+        std::pair<bool, V> r;
+        r.first = m_table->m_table.find(k, r.second);
+        return r;
+    }
+
+    //internal set
+    void _set(const K &k, const V &v) {
+        writable_table().set(k, v);
+    }
+
+    //internal erase
+    bool _erase(const K &k) {
+        return writable_table().erase(k);
+    }
+
+    //internal multi-get
+    void _multi_get(kv_get_request<K, V> &r) {
+        typename kv_gather<V>::values &values = r.m_gather->m_values;
+        for (size_t i = 0; i < r.m_keys.size(); ++i) {
+            std::pair<bool, V> &v = values[r.m_positions[i]];
+            v.first = m_table->m_table.find(r.m_keys[i], v.second);
+        }
+    }
+
+    //internal multi-set
+    void _multi_set(const items &i) {
+        kv_table<K, V, Hash> &t = writable_table();
+        for (typename items::const_iterator it = i.begin(); it != i.end(); ++it) {
+            t.set(it->first, it->second);
+        }
+    }
+
+    //internal snapshot
+    shared_table *_snapshot() {
+        m_table->inc_ref();
+        return m_table;
+    }
+};
+
+
+/** a point-in-time view of a key-value store.
+    Each shard is captured when it processes the snapshot request, so the
+    view contains all the operations the caller issued before the snapshot.
+    Reads do not go through the shards, so they run in the calling thread.
+    Value-type class; different values are thread-safe.
+ */
+template <class K, class V, class Hash = kv_hash<K> > class kv_snapshot {
+public:
+    //type of the shared table
+    typedef kv_shared_table<K, V, Hash> shared_table;
+
+    /** the constructor.
+        @param tables tables of the shards; ownership is taken.
+     */
+    kv_snapshot(const std::vector<shared_table *> &tables) : m_tables(tables) {}
+
+    /** the copy constructor.
+        @param s source object.
+     */
+    kv_snapshot(const kv_snapshot &s) : m_tables(s.m_tables) {
+        for (size_t i = 0; i < m_tables.size(); ++i) m_tables[i]->inc_ref();
+    }
+
+    /** the destructor.
+     */
+    ~kv_snapshot() {
+        for (size_t i = 0; i < m_tables.size(); ++i) m_tables[i]->dec_ref();
+    }
+
+    /** the assignment operator.
+        @param s source object.
+        @return reference to this.
+     */
+    kv_snapshot &operator = (const kv_snapshot &s) {
+        kv_snapshot t(s);
+        m_tables.swap(t.m_tables);
+        return *this;
+    }
+
+    /** finds a value.
+        @param k key.
+        @param v variable to copy the value to, if found.
+        @return true if found.
+     */
+    bool find(const K &k, V &v) const {
+        return m_tables[kv_route(m_hash(k), m_tables.size())]->m_table.find(k, v);
+    }
+
+    /** returns the number of entries.
+        @return the number of entries.
+     */
+    size_t size() const {
+        size_t n = 0;
+        for (size_t i = 0; i < m_tables.size(); ++i) n += m_tables[i]->m_table.size();
+        return n;
+    }
+
+private:
+    std::vector<shared_table *> m_tables;
+    Hash m_hash;
+};
+
+
+/** a key-value store, partitioned over a group of shard actors.
+    Keys are routed to shards by hash; batched operations send one
+    message per shard.
+    @param K type of key.
+    @param V type of value.
+    @param Hash hash function type.
+ */
+template <class K, class V, class Hash = kv_hash<K> > class kv_store {
+public:
+    //shard type
+    typedef kv_shard<K, V, Hash> shard;
+
+    //type of multi-get values
+    typedef std::vector<std::pair<bool, V> > values;
+
+    //type of multi-set items
+    typedef std::vector<std::pair<K, V> > items;
+
+    //snapshot type
+    typedef kv_snapshot<K, V, Hash> snapshot_type;
+
+    /** the constructor.
+        @param n number of shards; if 0, one shard per online processor is created.
+     */
+    kv_store(size_t n = 0) {
+        if (n == 0) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            n = cpus > 0 ? (size_t)cpus : 1;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            m_shards.push_back(new shard);
+        }
+    }
+
+    /** the destructor.
+     */
+    ~kv_store() {
+        for (size_t i = 0; i < m_shards.size(); ++i) {
+            delete m_shards[i];
+        }
+    }
+
+    /** gets a value.
+        @param k key.
+        @return a pair of a found flag and the value.
+     */
+    result<std::pair<bool, V> > get(const K &k) {
+        return shard_of(k).get(k);
+    }
+
+    /** sets a value.
+        @param k key.
+        @param v value.
+     */
+    void set(const K &k, const V &v) {
+        shard_of(k).set(k, v);
+    }
+
+    /** removes a key.
+        @param k key.
+        @return true if the key was found.
+     */
+    result<bool> erase(const K &k) {
+        return shard_of(k).erase(k);
+    }
+
+    /** returns the number of shards.
+        @return the number of shards.
+     */
+    size_t size() const {
+        return m_shards.size();
+    }
+
+    /** returns a shard.
+        @param i index of shard.
+        @return the shard.
+     */
+    shard &operator [](size_t i) {
+        return *m_shards[i];
+    }
+
+    /** gets many values.
+        @param keys keys.
+        @return pairs of a found flag and the value, in the order of the keys;
+            it fails if the request of a shard fails.
+     */
+    result<values> multi_get(const std::vector<K> &keys) {
+        result<values> r;
+        if (keys.empty()) {
+            r.set(values());
+            return r;
+        }
+
+        //split the keys per shard
+        std::vector<kv_get_request<K, V> *> requests(m_shards.size());
+        size_t count = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            size_t s = route(keys[i]);
+            if (!requests[s]) {
+                requests[s] = new kv_get_request<K, V>;
+                ++count;
+            }
+            requests[s]->m_keys.push_back(keys[i]);
+            requests[s]->m_positions.push_back(i);
+        }
+
+        //send them
+        kv_gather<V> *gather = new kv_gather<V>(keys.size(), count, r);
+        for (size_t s = 0; s < requests.size(); ++s) {
+            if (!requests[s]) continue;
+            requests[s]->m_gather = gather;
+            m_shards[s]->multi_get(requests[s]);
+        }
+        return r;
+    }
+
+    /** sets many values.
+        @param i items.
+     */
+    void multi_set(const items &i) {
+        std::vector<items *> parts(m_shards.size());
+        for (typename items::const_iterator it = i.begin(); it != i.end(); ++it) {
+            size_t s = route(it->first);
+            if (!parts[s]) parts[s] = new items;
+            parts[s]->push_back(*it);
+        }
+        for (size_t s = 0; s < parts.size(); ++s) {
+            if (parts[s]) m_shards[s]->multi_set(parts[s]);
+        }
+    }
+
+    /** takes a snapshot.
+        The calling thread blocks until all the shards have processed the request;
+        no table is copied at this point, only when a shard is later modified.
+        @return the snapshot.
+     */
+    snapshot_type snapshot() {
+        std::vector<result<typename shard::shared_table *> > r;
+        for (size_t s = 0; s < m_shards.size(); ++s) {
+            r.push_back(m_shards[s]->snapshot());
+        }
+        std::vector<typename shard::shared_table *> tables;
+        for (size_t s = 0; s < r.size(); ++s) {
+            tables.push_back(r[s].get());
+        }
+        return snapshot_type(tables);
+    }
+
+private:
+    //shards
+    std::vector<shard *> m_shards;
+
+    //hash function
+    Hash m_hash;
+
+    //not copyable
+    kv_store(const kv_store &);
+    kv_store &operator = (const kv_store &);
+
+    //returns the index of the shard of a key
+    size_t route(const K &k) const {
+        return kv_route(m_hash(k), m_shards.size());
+    }
+
+    //returns the shard of a key
+    shard &shard_of(const K &k) {
+        return *m_shards[route(k)];
+    }
+};
+
+
+} //namespace actorlib
+
+
+#endif //ACTORLIB_KVSTORE_HPP
@@ -0,0 +1,354 @@
+#ifndef ACTORLIB_PARALLEL_HPP
+#define ACTORLIB_PARALLEL_HPP
+
+
+#include <vector>
+#include <unistd.h>
+#include "actorlib.hpp"
+
+
+namespace actorlib {
+
+
+/** an actor which executes tasks.
+    It is the element of a worker group.
+ */
+class worker : public actor {
+public:
+    /** a task to execute in the context of a worker.
+     */
+    class task {
+    public:
+        /** the destructor.
+         */
+        virtual ~task() {}
+
+        /** executes the task.
+         */
+        virtual void run() = 0;
+    };
+
+    /** the destructor.
+     */
+    ~worker() {
+        stop();
+    }
+
+    /** puts a task.
+        The worker takes ownership of the task; it is deleted after it is executed.
+        @param t task.
+     */
+    void exec(task *t) {
+        put(&worker::_exec, t);
+    }
+
+private:
+    //internal exec; the task is deleted even if it throws
+    void _exec(task *const &t) {
+        try {
+            t->run();
+        }
+        catch (...) {
+            delete t;
+            throw;
+        }
+        delete t;
+    }
+};
+
+
+/** a group of workers.
+ */
+class worker_group {
+public:
+    /** the constructor.
+        @param n number of workers; if 0, one worker per online processor is created.
+     */
+    worker_group(size_t n = 0) {
+        if (n == 0) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            n = cpus > 0 ? (size_t)cpus : 1;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            m_workers.push_back(new worker);
+        }
+    }
+
+    /** the destructor.
+        It waits for all the workers to finish their tasks.
+     */
+    ~worker_group() {
+        for (size_t i = 0; i < m_workers.size(); ++i) {
+            delete m_workers[i];
+        }
+    }
+
+    /** returns the number of workers.
+        @return the number of workers.
+     */
+    size_t size() const {
+        return m_workers.size();
+    }
+
+    /** returns a worker.
+        @param i index of worker.
+        @return the worker.
+     */
+    worker &operator [](size_t i) {
+        return *m_workers[i];
+    }
+
+private:
+    //workers
+    std::vector<worker *> m_workers;
+
+    //not copyable
+    worker_group(const worker_group &);
+    worker_group &operator = (const worker_group &);
+};
+
+
+//internal state of a scatter-gather computation.
+//The partial results are combined in a binary tree: the second of
+//two siblings to finish combines them and goes on to the parent,
+//so no thread waits for another. If a function throws, the remaining
+//arrivals stop combining, and the last leaf to finish fails the result,
+//so as that the caller cannot go on while a function still runs;
+//then it deletes the state.
+template <class R, class F, class Reduce> class scatter_gather_state {
+public:
+    //constructor
+    scatter_gather_state(size_t n, const F &f, const Reduce &reduce, const result<R> &r) :
+        m_f(f), m_reduce(reduce), m_values(n), m_arrivals(n, 0), m_result(r),
+        m_failed(false), m_finished(0)
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+    }
+
+    //destructor
+    ~scatter_gather_state() {
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    //computes the value of leaf i, then combines upwards as far as possible
+    void run(size_t i) {
+        try {
+            m_values[i] = m_f(i);
+            if (combine(i)) m_result.set(m_values[0]);
+        }
+        catch (const std::exception &ex) {
+            fail(ex.what());
+        }
+        catch (...) {
+            fail("unknown exception");
+        }
+        finish();
+    }
+
+private:
+    F m_f;
+    Reduce m_reduce;
+    std::vector<R> m_values;
+    std::vector<int> m_arrivals;
+    result<R> m_result;
+    pthread_mutex_t m_mutex;
+
+    //set when a function threw
+    bool m_failed;
+
+    //description of the first failure
+    std::string m_error;
+
+    //number of leaves finished
+    size_t m_finished;
+
+    //combines upwards from leaf i; returns true if it combined the root
+    bool combine(size_t i) {
+        size_t n = m_values.size();
+        for (size_t step = 1; step < n; step *= 2) {
+            size_t parent = i & ~(2 * step - 1);
+            size_t right = parent + step;
+
+            //no right sibling; go on to the parent without combining
+            if (right >= n) {
+                i = parent;
+                continue;
+            }
+
+            //the first of the siblings to finish stops here;
+            //each right child index identifies exactly one parent;
+            //after a failure, nothing is combined
+            pthread_mutex_lock(&m_mutex);
+            bool second = ++m_arrivals[right] == 2 && !m_failed;
+            pthread_mutex_unlock(&m_mutex);
+            if (!second) return false;
+
+            m_values[parent] = m_reduce(m_values[parent], m_values[right]);
+            i = parent;
+        }
+
+        //this was the last one
+        return true;
+    }
+
+    //keeps the first failure, for the last leaf to report
+    void fail(const std::string &what) {
+        pthread_mutex_lock(&m_mutex);
+        if (!m_failed) m_error = what;
+        m_failed = true;
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    //fails the result if a function threw, and deletes the state, when the last leaf is finished
+    void finish() {
+        pthread_mutex_lock(&m_mutex);
+        bool last = ++m_finished == m_values.size();
+        pthread_mutex_unlock(&m_mutex);
+        if (!last) return;
+        if (m_failed) m_result.fail(m_error);
+        delete this;
+    }
+};
+
+
+//a task which computes one leaf of a scatter-gather computation
+template <class R, class F, class Reduce> class scatter_gather_task : public worker::task {
+public:
+    //constructor
+    scatter_gather_task(scatter_gather_state<R, F, Reduce> *state, size_t i) :
+        m_state(state), m_index(i) {}
+
+    //runs the leaf
+    virtual void run() {
+        m_state->run(m_index);
+    }
+
+private:
+    scatter_gather_state<R, F, Reduce> *m_state;
+    size_t m_index;
+};
+
+
+/** computes a value in each worker of a group, and reduces the values to one.
+    The reduction is done by the workers, as a tree, while the caller
+    may proceed to do other things.
+    @param R type of result.
+    @param g worker group.
+    @param f function object, invoked as R f(size_t i) in the context of worker i.
+    @param reduce function object, invoked as R reduce(const R &, const R &); it must be associative.
+    @return the reduced value; it fails if f or reduce throws,
+        when all the invocations of f are finished.
+ */
+template <class R, class F, class Reduce> result<R> scatter_gather(worker_group &g, const F &f, const Reduce &reduce) {
+    result<R> r;
+    scatter_gather_state<R, F, Reduce> *state = new scatter_gather_state<R, F, Reduce>(g.size(), f, reduce, r);
+    for (size_t i = 0; i < g.size(); ++i) {
+        g[i].exec(new scatter_gather_task<R, F, Reduce>(state, i));
+    }
+    return r;
+}
+
+
+//a range which is consumed in chunks by the workers of a parallel_for.
+//Chunks are handed out on demand, with a size proportional to the
+//remaining iterations (guided scheduling), so as that idle workers
+//take the work of busy ones and the last chunks are small.
+template <class F> class parallel_for_range {
+public:
+    //constructor
+    parallel_for_range(size_t begin, size_t end, size_t workers, size_t grain, const F &f) :
+        m_next(begin), m_end(end), m_workers(workers), m_grain(grain ? grain : 1), m_f(&f)
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+    }
+
+    //destructor
+    ~parallel_for_range() {
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    //executes chunks until the range is exhausted; returns the number of iterations executed
+    size_t run() {
+        size_t count = 0;
+        size_t begin, end;
+        while (next_chunk(begin, end)) {
+            for (size_t i = begin; i < end; ++i) {
+                (*m_f)(i);
+            }
+            count += end - begin;
+        }
+        return count;
+    }
+
+private:
+    pthread_mutex_t m_mutex;
+    size_t m_next;
+    size_t m_end;
+    size_t m_workers;
+    size_t m_grain;
+    const F *m_f;
+
+    //gets the next chunk
+    bool next_chunk(size_t &begin, size_t &end) {
+        pthread_mutex_lock(&m_mutex);
+        size_t remaining = m_end - m_next;
+        size_t chunk = remaining / (2 * m_workers);
+        if (chunk < m_grain) chunk = m_grain;
+        if (chunk > remaining) chunk = remaining;
+        begin = m_next;
+        end = m_next += chunk;
+        pthread_mutex_unlock(&m_mutex);
+        return chunk > 0;
+    }
+
+    //not copyable
+    parallel_for_range(const parallel_for_range &);
+    parallel_for_range &operator = (const parallel_for_range &);
+};
+
+
+//the function of each worker of a parallel_for
+template <class F> class parallel_for_body {
+public:
+    //constructor
+    parallel_for_body(parallel_for_range<F> &range) : m_range(&range) {}
+
+    //consumes the range
+    size_t operator ()(size_t) const {
+        return m_range->run();
+    }
+
+private:
+    parallel_for_range<F> *m_range;
+};
+
+
+//adds two counts
+struct parallel_for_sum {
+    size_t operator ()(const size_t &a, const size_t &b) const {
+        return a + b;
+    }
+};
+
+
+/** invokes a function for each index of a range, in the workers of a group.
+    The caller blocks until all the iterations are executed;
+    therefore it must not be one of the workers of the group.
+    @param begin first index.
+    @param end index after the last one.
+    @param g worker group.
+    @param f function object, invoked as f(size_t i) concurrently by many workers.
+    @param grain minimum number of iterations per chunk.
+    @exception actor_error thrown if f throws.
+ */
+template <class F> void parallel_for(size_t begin, size_t end, worker_group &g, const F &f, size_t grain = 1) {
+    if (begin >= end) return;
+    parallel_for_range<F> range(begin, end, g.size(), grain, f);
+    scatter_gather<size_t>(g, parallel_for_body<F>(range), parallel_for_sum()).get();
+}
+
+
+} //namespace actorlib
+
+
+#endif //ACTORLIB_PARALLEL_HPP
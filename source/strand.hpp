@@ -0,0 +1,302 @@
+#ifndef ACTORLIB_STRAND_HPP
+#define ACTORLIB_STRAND_HPP
+
+
+#include <vector>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include "actorlib.hpp"
+
+
+namespace actorlib {
+
+
+class strand_pool;
+
+
+/** serializes the execution of tasks, on the threads of a pool.
+
+    The tasks posted to a strand are executed one at a time, in the order
+    they were posted, like the messages of an actor, but by the threads
+    of a shared pool, so as that a strand needs no thread, mutex or
+    semaphore of its own, and every object can have one.
+
+    The tasks are owned by the caller and linked into the strand, so
+    posting allocates nothing: a push to a lock-free list, and, only when
+    the strand was idle, a push to the queue of the pool.
+ */
+class strand {
+public:
+    /** a task to execute in a strand.
+        It must stay alive until it is executed; it may be posted again
+        after that, even from its own run(), and it can be destroyed by
+        its run(). A task must not be posted twice before it is executed.
+     */
+    class task {
+    public:
+        /** the constructor.
+         */
+        task() : m_next(0) {}
+
+        /** the destructor.
+         */
+        virtual ~task() {}
+
+        /** executes the task.
+            An exception it throws is ignored, and the strand goes on
+            with the next task, like an actor without a supervisor.
+         */
+        virtual void run() = 0;
+
+    private:
+        //next task in the strand
+        task *m_next;
+
+        friend class strand;
+    };
+
+    /** a task which invokes a member function of an object.
+        @param C type of object.
+     */
+    template <class C> class method : public task {
+    public:
+        /** the constructor.
+            @param o object.
+            @param f member function of the object.
+         */
+        method(C *o, void (C::*f)()) : m_object(o), m_function(f) {}
+
+        /** invokes the member function.
+         */
+        virtual void run() {
+            (m_object->*m_function)();
+        }
+
+    private:
+        C *m_object;
+        void (C::*m_function)();
+    };
+
+    /** the constructor.
+        @param pool pool of the threads which execute the tasks;
+            it must outlive the strand.
+        @param batch maximum number of tasks executed before the thread
+            goes on to the other strands of the pool.
+     */
+    strand(strand_pool &pool, size_t batch = 64) :
+        m_posted(0), m_count(0), m_pool(&pool), m_batch(batch ? batch : 1),
+        m_local(0), m_next_ready(0) {}
+
+    /** the destructor.
+        It waits until the posted tasks are executed, so it may be invoked
+        by the last of them, from another thread, when it is done; but it
+        must not be invoked by a task of the strand itself.
+     */
+    ~strand() {
+        //a count below 0 is a post in progress, of a task already executed
+        while (atomic_load(&m_count) != 0) sched_yield();
+    }
+
+    /** posts a task.
+        The strand does not take ownership of the task.
+        @param t task.
+     */
+    void post(task *t);
+
+private:
+    //tasks posted and not taken yet, most recent first
+    void *volatile m_posted;
+
+    //number of tasks posted and not executed yet; the post which
+    //makes it 1 schedules the strand, which stays scheduled until it is 0
+    volatile long m_count;
+
+    //the pool
+    strand_pool *m_pool;
+
+    //maximum number of tasks per turn
+    size_t m_batch;
+
+    //tasks taken, in the order they were posted; only used by the executing thread
+    task *m_local;
+
+    //next strand in the queue of the pool
+    strand *m_next_ready;
+
+    //takes the posted tasks
+    void take();
+
+    //executes a turn of tasks, and schedules the strand again if there are more
+    void run();
+
+    //not copyable
+    strand(const strand &);
+    strand &operator = (const strand &);
+
+    friend class strand_pool;
+};
+
+
+/** a pool of threads which execute the tasks of strands.
+    The strands ready to execute are served in turn.
+ */
+class strand_pool {
+public:
+    /** the constructor.
+        @param n number of threads; if 0, one thread per online processor is created.
+     */
+    strand_pool(size_t n = 0) : m_head(0), m_tail(0), m_stopping(false) {
+        if (n == 0) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            n = cpus > 0 ? (size_t)cpus : 1;
+        }
+        pthread_mutex_init(&m_mutex, NULL);
+        sem_init(&m_sem, 0, 0);
+        m_threads.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            pthread_create(&m_threads[i], NULL, thread_proc, this);
+        }
+    }
+
+    /** the destructor.
+        It waits until the strands have executed their tasks; tasks
+        must not be posted from other threads after it is called.
+     */
+    ~strand_pool() {
+        pthread_mutex_lock(&m_mutex);
+        m_stopping = true;
+        pthread_mutex_unlock(&m_mutex);
+        for (size_t i = 0; i < m_threads.size(); ++i) {
+            sem_post(&m_sem);
+        }
+        for (size_t i = 0; i < m_threads.size(); ++i) {
+            pthread_join(m_threads[i], NULL);
+        }
+        sem_destroy(&m_sem);
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    /** returns the number of threads.
+        @return the number of threads.
+     */
+    size_t size() const {
+        return m_threads.size();
+    }
+
+private:
+    //mutex over the queue
+    pthread_mutex_t m_mutex;
+
+    //semaphore posted for each strand put in the queue, and for each thread when stopping
+    sem_t m_sem;
+
+    //queue of the strands ready to execute
+    strand *m_head;
+    strand *m_tail;
+
+    //set when the pool is destroyed
+    bool m_stopping;
+
+    //threads
+    std::vector<pthread_t> m_threads;
+
+    //puts a strand at the end of the queue
+    void schedule(strand *s) {
+        s->m_next_ready = 0;
+        pthread_mutex_lock(&m_mutex);
+        if (m_tail) m_tail->m_next_ready = s; else m_head = s;
+        m_tail = s;
+        pthread_mutex_unlock(&m_mutex);
+        sem_post(&m_sem);
+    }
+
+    //waits for the next strand; returns null when the pool is stopping and the queue is empty
+    strand *next() {
+        for (;;) {
+            while (sem_wait(&m_sem) != 0 && errno == EINTR) {}
+            pthread_mutex_lock(&m_mutex);
+            strand *s = m_head;
+            if (s) {
+                m_head = s->m_next_ready;
+                if (!m_head) m_tail = 0;
+            }
+            bool stopping = m_stopping;
+            pthread_mutex_unlock(&m_mutex);
+            if (s) return s;
+            if (stopping) return 0;
+        }
+    }
+
+    //the thread function
+    static void *thread_proc(void *arg) {
+        strand_pool *pool = reinterpret_cast<strand_pool *>(arg);
+        while (strand *s = pool->next()) {
+            s->run();
+        }
+        return 0;
+    }
+
+    //not copyable
+    strand_pool(const strand_pool &);
+    strand_pool &operator = (const strand_pool &);
+
+    friend class strand;
+};
+
+
+//posts a task
+inline void strand::post(task *t) {
+    void *head;
+    do {
+        head = atomic_load(&m_posted);
+        t->m_next = static_cast<task *>(head);
+    } while (!atomic_compare_exchange(&m_posted, head, t));
+
+    //the task is counted after it is pushed, so as that the thread which
+    //sees the count also finds the task; only an idle strand is scheduled
+    if (atomic_increment(&m_count) == 1) m_pool->schedule(this);
+}
+
+
+//takes the posted tasks
+inline void strand::take() {
+    task *t = static_cast<task *>(atomic_exchange(&m_posted, 0));
+
+    //the list is reversed, for the order the tasks were posted
+    while (t) {
+        task *next = t->m_next;
+        t->m_next = m_local;
+        m_local = t;
+        t = next;
+    }
+}
+
+
+//executes a turn of tasks, and schedules the strand again if there are more
+inline void strand::run() {
+    size_t n = 0;
+    if (!m_local) take();
+    while (m_local && n < m_batch) {
+        //the task may be posted again, or destroyed, by its run()
+        task *t = m_local;
+        m_local = t->m_next;
+        ++n;
+        try {
+            t->run();
+        }
+        catch (...) {
+        }
+        if (!m_local) take();
+    }
+
+    //a task executed before its post counted it makes the count drop below 0
+    //for a while; that post brings it back, without scheduling the strand
+    if (atomic_add(&m_count, -(long)n) > 0) m_pool->schedule(this);
+}
+
+
+} //namespace actorlib
+
+
+#endif //ACTORLIB_STRAND_HPP
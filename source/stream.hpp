@@ -0,0 +1,506 @@
+#ifndef ACTORLIB_STREAM_HPP
+#define ACTORLIB_STREAM_HPP
+
+
+#include <vector>
+#include <map>
+#include <utility>
+#include "actorlib.hpp"
+
+
+namespace actorlib {
+
+
+/** stream operators built on actors.
+
+    A stream is a chain of sinks; each operator is an actor which receives
+    items through its push() function and pushes its output to the next sink.
+
+    Stateless operators (map, filter) are stages, i.e. plain function objects
+    which are run by a stage_actor. Adjacent stages can be fused with the
+    function fuse(), so as that the whole chain runs inside one actor,
+    without a message per stage.
+ */
+namespace stream {
+
+
+/** the receiver of stream items.
+    @param T type of item.
+ */
+template <class T> class sink {
+public:
+    /** the destructor.
+     */
+    virtual ~sink() {}
+
+    /** pushes an item.
+        @param v item.
+     */
+    virtual void push(const T &v) = 0;
+};
+
+
+/** a stage which maps an item to another item.
+    @param In type of input.
+    @param Out type of output.
+    @param F function object type; it is invoked as Out f(const In &).
+ */
+template <class In, class Out, class F> class map_stage {
+public:
+    //input type
+    typedef In input_type;
+
+    //output type
+    typedef Out output_type;
+
+    /** the constructor.
+        @param f function object.
+     */
+    map_stage(const F &f) : m_f(f) {}
+
+    /** applies the stage.
+        @param in input.
+        @param out output.
+        @return always true.
+     */
+    bool operator ()(const In &in, Out &out) {
+        out = m_f(in);
+        return true;
+    }
+
+private:
+    F m_f;
+};
+
+
+/** a stage which drops the items that do not satisfy a predicate.
+    @param T type of item.
+    @param F predicate type; it is invoked as bool f(const T &).
+ */
+template <class T, class F> class filter_stage {
+public:
+    //input type
+    typedef T input_type;
+
+    //output type
+    typedef T output_type;
+
+    /** the constructor.
+        @param f predicate.
+     */
+    filter_stage(const F &f) : m_f(f) {}
+
+    /** applies the stage.
+        @param in input.
+        @param out output; set only if the predicate is satisfied.
+        @return true if the item passes.
+     */
+    bool operator ()(const T &in, T &out) {
+        if (!m_f(in)) return false;
+        out = in;
+        return true;
+    }
+
+private:
+    F m_f;
+};
+
+
+/** two adjacent stages fused into one.
+    @param S1 first stage.
+    @param S2 second stage; its input type must be the output type of S1.
+ */
+template <class S1, class S2> class fused_stage {
+public:
+    //input type
+    typedef typename S1::input_type input_type;
+
+    //output type
+    typedef typename S2::output_type output_type;
+
+    /** the constructor.
+        @param s1 first stage.
+        @param s2 second stage.
+     */
+    fused_stage(const S1 &s1, const S2 &s2) : m_s1(s1), m_s2(s2) {}
+
+    /** applies both stages.
+        @param in input.
+        @param out output.
+        @return true if the item passed both stages.
+     */
+    bool operator ()(const input_type &in, output_type &out) {
+        typename S1::output_type t;
+        return m_s1(in, t) && m_s2(t, out);
+    }
+
+private:
+    S1 m_s1;
+    S2 m_s2;
+};
+
+
+/** creates a map stage.
+    @param f function object.
+    @return the stage.
+ */
+template <class In, class Out, class F> map_stage<In, Out, F> map(F f) {
+    return map_stage<In, Out, F>(f);
+}
+
+
+/** creates a filter stage.
+    @param f predicate.
+    @return the stage.
+ */
+template <class T, class F> filter_stage<T, F> filter(F f) {
+    return filter_stage<T, F>(f);
+}
+
+
+/** fuses two adjacent stages.
+    @param s1 first stage.
+    @param s2 second stage.
+    @return the fused stage.
+ */
+template <class S1, class S2> fused_stage<S1, S2> fuse(const S1 &s1, const S2 &s2) {
+    return fused_stage<S1, S2>(s1, s2);
+}
+
+
+/** an actor which runs a stage, fused or not.
+    @param S stage type.
+ */
+template <class S> class stage_actor :
+    public actor,
+    public sink<typename S::input_type>
+{
+public:
+    //input type
+    typedef typename S::input_type input_type;
+
+    //output type
+    typedef typename S::output_type output_type;
+
+    /** the constructor.
+        @param s stage.
+        @param next sink to push the output to.
+     */
+    stage_actor(const S &s, sink<output_type> &next) :
+        m_stage(s), m_next(&next) {}
+
+    /** the destructor.
+     */
+    ~stage_actor() {
+        stop();
+    }
+
+    /** pushes an item.
+        @param v item.
+     */
+    void push(const input_type &v) {
+        put(&stage_actor::_push, v);
+    }
+
+private:
+    //members
+    S m_stage;
+    sink<output_type> *m_next;
+
+    //internal push
+    void _push(const input_type &v) {
+        output_type out;
+        if (m_stage(v, out)) m_next->push(out);
+    }
+};
+
+
+/** an actor which groups items in windows of a specific size.
+    @param T type of item.
+ */
+template <class T> class count_window :
+    public actor,
+    public sink<T>
+{
+public:
+    /** the constructor.
+        @param n number of items per window.
+        @param next sink to push the windows to.
+     */
+    count_window(size_t n, sink<std::vector<T> > &next) :
+        m_size(n), m_next(&next)
+    {
+        m_items.reserve(n);
+    }
+
+    /** the destructor.
+     */
+    ~count_window() {
+        stop();
+    }
+
+    /** pushes an item.
+        @param v item.
+     */
+    void push(const T &v) {
+        put(&count_window::_push, v);
+    }
+
+    /** pushes the current window, even if it is not full.
+     */
+    void flush() {
+        put(&count_window::_flush);
+    }
+
+private:
+    //members
+    size_t m_size;
+    sink<std::vector<T> > *m_next;
+    std::vector<T> m_items;
+
+    //internal push
+    void _push(const T &v) {
+        m_items.push_back(v);
+        if (m_items.size() >= m_size) _flush();
+    }
+
+    //internal flush
+    void _flush() {
+        if (m_items.empty()) return;
+        std::vector<T> items;
+        items.reserve(m_size);
+        items.swap(m_items);
+        m_next->push(items);
+    }
+};
+
+
+/** an actor which groups the items received within a specific period.
+    A window is opened by its first item, and it is pushed when
+    the period elapses.
+    @param T type of item.
+ */
+template <class T> class time_window :
+    public actor,
+    public sink<T>
+{
+public:
+    /** the constructor.
+        @param t timer used for closing the windows.
+        @param ms window period, in milliseconds.
+        @param next sink to push the windows to.
+     */
+    time_window(timer &t, unsigned long ms, sink<std::vector<T> > &next) :
+        m_timer(&t), m_period(ms), m_next(&next), m_window(0), m_task(0) {}
+
+    /** the destructor.
+     */
+    ~time_window() {
+        stop();
+        if (m_task) m_timer->cancel(m_task);
+    }
+
+    /** pushes an item.
+        @param v item.
+     */
+    void push(const T &v) {
+        put(&time_window::_push, v);
+    }
+
+    /** pushes the current window before its period elapses.
+     */
+    void flush() {
+        put(&time_window::_flush);
+    }
+
+private:
+    //the task which closes a window
+    class close_task : public timer::task {
+    public:
+        close_task(time_window *w, unsigned long n) : m_owner(w), m_window(n) {}
+
+        virtual void run() {
+            m_owner->put(&time_window::_close, m_window);
+        }
+
+    private:
+        time_window *m_owner;
+        unsigned long m_window;
+    };
+
+    //members
+    timer *m_timer;
+    unsigned long m_period;
+    sink<std::vector<T> > *m_next;
+    std::vector<T> m_items;
+
+    //current window number; used for ignoring stale close tasks
+    unsigned long m_window;
+
+    //task of the current window
+    timer::id m_task;
+
+    //internal push
+    void _push(const T &v) {
+        if (m_items.empty()) {
+            m_task = m_timer->schedule(new close_task(this, m_window), m_period);
+        }
+        m_items.push_back(v);
+    }
+
+    //internal flush
+    void _flush() {
+        if (m_items.empty()) return;
+        if (m_task) m_timer->cancel(m_task);
+        m_task = 0;
+        ++m_window;
+        std::vector<T> items;
+        items.swap(m_items);
+        m_next->push(items);
+    }
+
+    //internal close of the window with the given number
+    void _close(const unsigned long &n) {
+        if (n == m_window) _flush();
+    }
+};
+
+
+/** an actor which reduces the values of each key.
+    For each item, the accumulated value of its key is pushed.
+    @param K type of key.
+    @param V type of value.
+    @param F reduce function type; it is invoked as V f(const V &acc, const V &v).
+ */
+template <class K, class V, class F> class reduce_by_key :
+    public actor,
+    public sink<std::pair<K, V> >
+{
+public:
+    //item type
+    typedef std::pair<K, V> item_type;
+
+    /** the constructor.
+        @param f reduce function.
+        @param next sink to push the accumulated values to.
+     */
+    reduce_by_key(const F &f, sink<item_type> &next) :
+        m_f(f), m_next(&next) {}
+
+    /** the destructor.
+     */
+    ~reduce_by_key() {
+        stop();
+    }
+
+    /** pushes an item.
+        @param v item.
+     */
+    void push(const item_type &v) {
+        put(&reduce_by_key::_push, v);
+    }
+
+private:
+    //members
+    F m_f;
+    sink<item_type> *m_next;
+    std::map<K, V> m_values;
+
+    //internal push
+    void _push(const item_type &v) {
+        typename std::map<K, V>::iterator it = m_values.find(v.first);
+        if (it == m_values.end()) {
+            it = m_values.insert(v).first;
+        }
+        else {
+            it->second = m_f(it->second, v.second);
+        }
+        m_next->push(*it);
+    }
+};
+
+
+/** an actor which merges the items of many streams into one.
+    Any number of upstream operators may push to it; the items
+    are pushed to the next sink one at a time.
+    @param T type of item.
+ */
+template <class T> class merge :
+    public actor,
+    public sink<T>
+{
+public:
+    /** the constructor.
+        @param next sink to push the items to.
+     */
+    merge(sink<T> &next) : m_next(&next) {}
+
+    /** the destructor.
+     */
+    ~merge() {
+        stop();
+    }
+
+    /** pushes an item.
+        @param v item.
+     */
+    void push(const T &v) {
+        put(&merge::_push, v);
+    }
+
+private:
+    //next sink
+    sink<T> *m_next;
+
+    //internal push
+    void _push(const T &v) {
+        m_next->push(v);
+    }
+};
+
+
+/** an actor which ends a stream by invoking a function for each item.
+    @param T type of item.
+    @param F function object type; it is invoked as f(const T &).
+ */
+template <class T, class F> class for_each :
+    public actor,
+    public sink<T>
+{
+public:
+    /** the constructor.
+        @param f function object.
+     */
+    for_each(const F &f) : m_f(f) {}
+
+    /** the destructor.
+     */
+    ~for_each() {
+        stop();
+    }
+
+    /** pushes an item.
+        @param v item.
+     */
+    void push(const T &v) {
+        put(&for_each::_push, v);
+    }
+
+private:
+    //function object
+    F m_f;
+
+    //internal push
+    void _push(const T &v) {
+        m_f(v);
+    }
+};
+
+
+} //namespace stream
+
+
+} //namespace actorlib
+
+
+#endif //ACTORLIB_STREAM_HPP
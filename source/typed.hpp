@@ -0,0 +1,552 @@
+#ifndef ACTORLIB_TYPED_HPP
+#define ACTORLIB_TYPED_HPP
+
+
+#include <new>
+#include <vector>
+#include "kvstore.hpp"
+
+
+namespace actorlib {
+
+
+/** placeholder for the unused message types of a typed actor.
+ */
+struct no_message {};
+
+
+/** the correlation key of a message type, for selective receive.
+    The generic version gives the same key to all the messages of a type,
+    so as that they are selected by type only; specialize it for the types
+    which carry a correlation id.
+    @param T type of message.
+ */
+template <class T> struct message_key {
+    /** returns the key of a message.
+        @return the key.
+     */
+    static long long get(const T &) {
+        return 0;
+    }
+};
+
+
+//index of a type in a list of message types;
+//a type not in the list leaves it undefined, so as that sending it does not compile
+template <class T, class T0, class T1, class T2, class T3, class T4, class T5, class T6, class T7> struct typed_index {
+    enum { value = 1 + typed_index<T, T1, T2, T3, T4, T5, T6, T7, no_message>::value };
+};
+
+
+//the type is found
+template <class T, class T1, class T2, class T3, class T4, class T5, class T6, class T7> struct typed_index<T, T, T1, T2, T3, T4, T5, T6, T7> {
+    enum { value = 0 };
+};
+
+
+//the type is not found
+template <class T> struct typed_index<T, no_message, no_message, no_message, no_message, no_message, no_message, no_message, no_message>;
+
+
+//maximum of two sizes
+template <size_t A, size_t B> struct typed_max {
+    enum { value = A > B ? A : B };
+};
+
+
+//operations on a value of a message type, stored in a slot of the mailbox
+template <class T> struct typed_ops {
+    //destroys the value
+    static void destroy(void *p) {
+        static_cast<T *>(p)->~T();
+    }
+
+    //copies the value to uninitialized storage
+    static void copy(void *dst, const void *src) {
+        new (dst) T(*static_cast<const T *>(src));
+    }
+
+    //returns the correlation key of the value
+    static long long key(const void *p) {
+        return message_key<T>::get(*static_cast<const T *>(p));
+    }
+};
+
+
+//operations on the placeholder, which also marks the slots taken by selective receive
+template <> struct typed_ops<no_message> {
+    static void destroy(void *) {}
+    static void copy(void *, const void *) {}
+    static long long key(const void *) { return 0; }
+};
+
+
+/** an actor which receives messages by value.
+
+    The derived class lists the types of the messages it accepts, and
+    has a receive function for each of them; send() copies a message
+    in the mailbox of the actor, and the actor thread passes it to the
+    receive function for its type. Messages are stored in slots sized for
+    the largest type, tagged with the index of their type, and dispatched
+    through a table of functions generated at compile time; sending a type
+    which is not in the list does not compile.
+
+    The mailbox is two arrays of slots: senders append to one, while the
+    actor thread receives from the other, and they are swapped when the
+    latter is empty. The arrays are made of fixed-size chunks, which are
+    never freed or moved, so, in the steady state, sending allocates nothing;
+    a message is put to the actor only when the mailbox becomes non-empty,
+    to have it drained, and then it is never rejected, expired or throttled.
+    Pointer-to-member messages may still be put, and are interleaved with
+    the batches of the mailbox; their order relative to sent messages is
+    not preserved, so a reply to a sent message should be sent in it,
+    as a result.
+
+    The receive functions are called from typed_actor, which must be a
+    friend of the derived class if they are not public. They may take
+    the message by non-const reference, so as to swap its contents out.
+    If one throws, the failure is handled as for any other message, and
+    the rest of the batch is received afterwards. Messages still in the
+    mailbox when the actor is destroyed are destroyed without being received.
+
+    @param D type of the derived class.
+    @param T0 - T7 types of messages; unused ones are no_message.
+ */
+template <class D, class T0, class T1 = no_message, class T2 = no_message, class T3 = no_message,
+          class T4 = no_message, class T5 = no_message, class T6 = no_message, class T7 = no_message>
+class typed_actor : public actor {
+public:
+    /** the constructor.
+        @param mr memory resource for the pointer-to-member messages of this actor.
+     */
+    typed_actor(memory_resource *mr = 0) :
+        actor(mr), m_scheduled(false), m_drain_failures(0), m_selecting(false), m_read(0), m_indexed(0)
+    {
+        pthread_mutex_init(&m_mutex, 0);
+        monotonic_cond_init(&m_sent);
+    }
+
+    /** the destructor.
+        The derived class should call stop() from its own destructor,
+        since the actor thread uses its receive functions.
+     */
+    ~typed_actor() {
+        stop();
+        for (size_t i = m_read; i < m_front.m_size; ++i) {
+            m_front.destroy(i);
+        }
+        for (size_t i = 0; i < m_back.m_size; ++i) {
+            m_back.destroy(i);
+        }
+        pthread_cond_destroy(&m_sent);
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    /** sends a message.
+        Thread-safe.
+        @param v message; it is copied in the mailbox.
+        @exception actor_error thrown if the actor is terminated, and so
+            the mailbox is not drained; the message stays in it, and is
+            received only if the actor is restarted.
+     */
+    template <class T> void send(const T &v) {
+        const size_t type = typed_index<T, T0, T1, T2, T3, T4, T5, T6, T7>::value;
+        pthread_mutex_lock(&m_mutex);
+        try {
+            m_back.push(v, type);
+        }
+        catch (...) {
+            pthread_mutex_unlock(&m_mutex);
+            throw;
+        }
+        if (m_selecting) pthread_cond_signal(&m_sent);
+        bool schedule = !m_scheduled;
+        m_scheduled = true;
+        unsigned long failures = m_drain_failures;
+        pthread_mutex_unlock(&m_mutex);
+        if (!schedule) return;
+
+        //while scheduled, no other drain message is in flight, so a failure counted now is of this one
+        put(new (m_resource) drain_message(this), PUT_CONTROL);
+        pthread_mutex_lock(&m_mutex);
+        bool failed = m_drain_failures != failures;
+        std::string what = m_drain_error;
+        pthread_mutex_unlock(&m_mutex);
+        if (failed) throw actor_error(what);
+    }
+
+protected:
+    /** selective receive: takes the first message of a type and key out of the mailbox.
+        The other messages stay in the mailbox, in order, and are received
+        later. The mailbox is indexed by type and key as it is searched,
+        so each message is examined once, however many searches skip it.
+        It must be called from a receive function; it blocks the actor
+        thread, so no other message, including exit, is executed while
+        it waits.
+        @param v variable the message is swapped into.
+        @param key correlation key, as returned by message_key<T>.
+        @param timeout_ms maximum time to wait for the message, in milliseconds;
+            if 0, only the messages already in the mailbox are searched.
+        @return true if a message was taken, false on timeout.
+     */
+    template <class T> bool select_message(T &v, long long key = 0, unsigned long timeout_ms = 0) {
+        const size_t type = typed_index<T, T0, T1, T2, T3, T4, T5, T6, T7>::value;
+        unsigned long long deadline = now_ns() + timeout_ms * 1000000ULL;
+        for (;;) {
+            //index the messages added since the last search
+            if (m_index.empty()) m_index.resize(TYPES);
+            if (m_indexed < m_read) m_indexed = m_read;
+            m_next.resize(m_front.m_size);
+            for (; m_indexed < m_front.m_size; ++m_indexed) {
+                add_index(m_indexed);
+            }
+
+            //take the first match
+            size_t i;
+            if (find_index(type, key, i)) {
+                slot &s = m_front[i];
+                using std::swap;
+                swap(v, *reinterpret_cast<T *>(s.m_value.m_data));
+                m_front.destroy(i);
+                s.m_type = TAKEN;
+                return true;
+            }
+
+            //wait for more messages, and move them after the ones searched
+            pthread_mutex_lock(&m_mutex);
+            if (!wait_sent(deadline)) {
+                pthread_mutex_unlock(&m_mutex);
+                return false;
+            }
+            try {
+                m_front.append(m_back);
+            }
+            catch (...) {
+                pthread_mutex_unlock(&m_mutex);
+                throw;
+            }
+            pthread_mutex_unlock(&m_mutex);
+        }
+    }
+
+private:
+    //number of message types, and the type of the slots taken by selective receive
+    enum {
+        TYPES = 8,
+        TAKEN = 8
+    };
+
+    //number of slots in a chunk of a buffer
+    enum { CHUNK_SIZE = 64 };
+
+    //size of the largest message type
+    enum {
+        VALUE_SIZE = typed_max<typed_max<typed_max<sizeof(T0), sizeof(T1)>::value, typed_max<sizeof(T2), sizeof(T3)>::value>::value,
+                               typed_max<typed_max<sizeof(T4), sizeof(T5)>::value, typed_max<sizeof(T6), sizeof(T7)>::value>::value>::value
+    };
+
+    //the message which drains the mailbox; if it is not executed, because
+    //the actor is terminated, the next send puts another one
+    class drain_message : public message {
+    public:
+        explicit drain_message(typed_actor *a) : m_actor(a) {}
+
+        virtual void exec() {
+            m_actor->_drain();
+        }
+
+        virtual void fail(const std::string &what) {
+            pthread_mutex_lock(&m_actor->m_mutex);
+            m_actor->m_scheduled = false;
+            ++m_actor->m_drain_failures;
+            m_actor->m_drain_error = what;
+            pthread_mutex_unlock(&m_actor->m_mutex);
+        }
+
+    private:
+        typed_actor *m_actor;
+    };
+
+    //passes a value to the receive function of the derived class
+    template <class T, class Dummy = void> struct receiver {
+        static void receive(D *d, void *p) {
+            d->receive(*static_cast<T *>(p));
+        }
+    };
+
+    //the placeholder is never received
+    template <class Dummy> struct receiver<no_message, Dummy> {
+        static void receive(D *, void *) {}
+    };
+
+    //operations of a message type
+    struct operations {
+        void (*receive)(D *, void *);
+        void (*destroy)(void *);
+        void (*copy)(void *, const void *);
+        long long (*key)(const void *);
+    };
+
+    //a slot of the mailbox; the union aligns the value for any type
+    struct slot {
+        union {
+            char m_data[VALUE_SIZE];
+            long double m_align1;
+            long long m_align2;
+            void *m_align3;
+        } m_value;
+        size_t m_type;
+    };
+
+    //array of slots, made of chunks which are never moved,
+    //so as that a message stays in place while it is received
+    class buffer {
+    public:
+        //number of used slots
+        size_t m_size;
+
+        //empty buffer
+        buffer() : m_size(0) {}
+
+        //frees the chunks; values must have been destroyed
+        ~buffer() {
+            for (size_t i = 0; i < m_chunks.size(); ++i) {
+                ::operator delete(m_chunks[i]);
+            }
+        }
+
+        //returns a slot
+        slot &operator [](size_t i) {
+            return m_chunks[i / CHUNK_SIZE][i % CHUNK_SIZE];
+        }
+
+        //copies a value at the end, adding a chunk if the buffer is full
+        template <class T> void push(const T &v, size_t type) {
+            if (m_size == m_chunks.size() * CHUNK_SIZE) grow();
+            slot &s = (*this)[m_size];
+            new (s.m_value.m_data) T(v);
+            s.m_type = type;
+            ++m_size;
+        }
+
+        //moves the values of another buffer at the end; a moved slot is marked taken,
+        //so as that the other buffer is consistent if a copy throws
+        void append(buffer &b) {
+            for (size_t i = 0; i < b.m_size; ++i) {
+                slot &src = b[i];
+                if (src.m_type == TAKEN) continue;
+                if (m_size == m_chunks.size() * CHUNK_SIZE) grow();
+                slot &dst = (*this)[m_size];
+                table[src.m_type].copy(dst.m_value.m_data, src.m_value.m_data);
+                dst.m_type = src.m_type;
+                ++m_size;
+                b.destroy(i);
+                src.m_type = TAKEN;
+            }
+            b.m_size = 0;
+        }
+
+        //receives the value of a slot
+        void receive(size_t i, D *d) {
+            slot &s = (*this)[i];
+            table[s.m_type].receive(d, s.m_value.m_data);
+        }
+
+        //destroys the value of a slot
+        void destroy(size_t i) {
+            slot &s = (*this)[i];
+            table[s.m_type].destroy(s.m_value.m_data);
+        }
+
+        //returns the correlation key of the value of a slot
+        long long key(size_t i) {
+            slot &s = (*this)[i];
+            return table[s.m_type].key(s.m_value.m_data);
+        }
+
+        //exchanges the slots with another buffer
+        void swap(buffer &b) {
+            m_chunks.swap(b.m_chunks);
+            std::swap(m_size, b.m_size);
+        }
+
+    private:
+        //chunks
+        std::vector<slot *> m_chunks;
+
+        //adds a chunk
+        void grow() {
+            slot *chunk = static_cast<slot *>(::operator new(CHUNK_SIZE * sizeof(slot)));
+            try {
+                m_chunks.push_back(chunk);
+            }
+            catch (...) {
+                ::operator delete(chunk);
+                throw;
+            }
+        }
+
+        //not copyable
+        buffer(const buffer &);
+        buffer &operator = (const buffer &);
+    };
+
+    //the slots of the received buffer with the same type and key, in order
+    struct chain {
+        size_t m_first;
+        size_t m_last;
+    };
+
+    //index of the received buffer, from key to chain
+    typedef kv_table<long long, chain> key_index;
+
+    //the dispatch table, indexed by message type; the last entry is for taken slots
+    static const operations table[TYPES + 1];
+
+    //mutex of the senders' buffer and of the flags
+    pthread_mutex_t m_mutex;
+
+    //signalled on send while the actor thread waits in selective receive
+    pthread_cond_t m_sent;
+
+    //the buffer senders append to
+    buffer m_back;
+
+    //true if a drain message is put, and has not yet found the mailbox empty
+    bool m_scheduled;
+
+    //number of drain messages failed, and the description of the last failure
+    unsigned long m_drain_failures;
+    std::string m_drain_error;
+
+    //true while the actor thread waits in selective receive
+    bool m_selecting;
+
+    //the buffer the actor thread receives from, and the next slot to receive
+    buffer m_front;
+    size_t m_read;
+
+    //selective receive: an index per type, empty until first used;
+    //the next slot in the chain of each slot; the number of indexed slots
+    std::vector<key_index> m_index;
+    std::vector<size_t> m_next;
+    size_t m_indexed;
+
+    //adds a slot of the received buffer to the index
+    void add_index(size_t i) {
+        size_t type = m_front[i].m_type;
+        if (type == TAKEN) return;
+        long long key = m_front.key(i);
+        chain c;
+        if (m_index[type].find(key, c)) {
+            m_next[c.m_last] = i;
+            c.m_last = i;
+        }
+        else {
+            c.m_first = c.m_last = i;
+        }
+        m_index[type].set(key, c);
+    }
+
+    //finds the first slot with a type and key which is neither received nor taken,
+    //and removes it from the index; the slots skipped are removed too
+    bool find_index(size_t type, long long key, size_t &i) {
+        chain c;
+        if (!m_index[type].find(key, c)) return false;
+        for (i = c.m_first; i < m_read || m_front[i].m_type != type; i = m_next[i]) {
+            if (i == c.m_last) {
+                m_index[type].erase(key);
+                return false;
+            }
+        }
+        if (i == c.m_last) {
+            m_index[type].erase(key);
+        }
+        else {
+            c.m_first = m_next[i];
+            m_index[type].set(key, c);
+        }
+        return true;
+    }
+
+    //clears the index, when the received buffer is reused
+    void clear_index() {
+        if (!m_indexed) return;
+        m_indexed = 0;
+        for (size_t t = 0; t < m_index.size(); ++t) {
+            if (m_index[t].size()) m_index[t] = key_index();
+        }
+    }
+
+    //waits until the senders' buffer is not empty, or the deadline; synchronized by the caller
+    bool wait_sent(unsigned long long deadline) {
+        timespec ts;
+        ts.tv_sec = (time_t)(deadline / 1000000000ULL);
+        ts.tv_nsec = (long)(deadline % 1000000000ULL);
+        m_selecting = true;
+        while (m_back.m_size == 0) {
+            if (now_ns() >= deadline || pthread_cond_timedwait(&m_sent, &m_mutex, &ts) == ETIMEDOUT) break;
+        }
+        m_selecting = false;
+        return m_back.m_size > 0;
+    }
+
+    //receives a batch of messages; puts itself again if more were sent meanwhile
+    void _drain() {
+        //take the sent messages, unless a batch was interrupted by an exception
+        if (m_read == m_front.m_size) {
+            m_front.m_size = 0;
+            m_read = 0;
+            clear_index();
+            pthread_mutex_lock(&m_mutex);
+            m_front.swap(m_back);
+            pthread_mutex_unlock(&m_mutex);
+        }
+
+        //receive the batch; selective receive may append to it
+        D *d = static_cast<D *>(this);
+        while (m_read < m_front.m_size) {
+            size_t i = m_read++;
+            try {
+                m_front.receive(i, d);
+            }
+            catch (...) {
+                m_front.destroy(i);
+                put(new (m_resource) drain_message(this), PUT_CONTROL);
+                throw;
+            }
+            m_front.destroy(i);
+        }
+        m_front.m_size = 0;
+        m_read = 0;
+        clear_index();
+
+        //continue with the messages sent meanwhile, after the other messages of the actor
+        pthread_mutex_lock(&m_mutex);
+        bool more = m_back.m_size > 0;
+        if (!more) m_scheduled = false;
+        pthread_mutex_unlock(&m_mutex);
+        if (more) put(new (m_resource) drain_message(this), PUT_CONTROL);
+    }
+};
+
+
+//the dispatch table
+template <class D, class T0, class T1, class T2, class T3, class T4, class T5, class T6, class T7>
+const typename typed_actor<D, T0, T1, T2, T3, T4, T5, T6, T7>::operations typed_actor<D, T0, T1, T2, T3, T4, T5, T6, T7>::table[TYPES + 1] = {
+    { &typed_actor::template receiver<T0>::receive, &typed_ops<T0>::destroy, &typed_ops<T0>::copy, &typed_ops<T0>::key },
+    { &typed_actor::template receiver<T1>::receive, &typed_ops<T1>::destroy, &typed_ops<T1>::copy, &typed_ops<T1>::key },
+    { &typed_actor::template receiver<T2>::receive, &typed_ops<T2>::destroy, &typed_ops<T2>::copy, &typed_ops<T2>::key },
+    { &typed_actor::template receiver<T3>::receive, &typed_ops<T3>::destroy, &typed_ops<T3>::copy, &typed_ops<T3>::key },
+    { &typed_actor::template receiver<T4>::receive, &typed_ops<T4>::destroy, &typed_ops<T4>::copy, &typed_ops<T4>::key },
+    { &typed_actor::template receiver<T5>::receive, &typed_ops<T5>::destroy, &typed_ops<T5>::copy, &typed_ops<T5>::key },
+    { &typed_actor::template receiver<T6>::receive, &typed_ops<T6>::destroy, &typed_ops<T6>::copy, &typed_ops<T6>::key },
+    { &typed_actor::template receiver<T7>::receive, &typed_ops<T7>::destroy, &typed_ops<T7>::copy, &typed_ops<T7>::key },
+    { &typed_actor::template receiver<no_message>::receive, &typed_ops<no_message>::destroy, &typed_ops<no_message>::copy, &typed_ops<no_message>::key }
+};
+
+
+} //namespace actorlib
+
+
+#endif //ACTORLIB_TYPED_HPP